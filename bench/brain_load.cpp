@@ -0,0 +1,526 @@
+// brain_load - HTTP load generator for a running BrainLLM_API.
+//
+//   brain_load [--host ADDR] [--port N] [--connections N] [--duration SECONDS]
+//              [--warmup SECONDS] [--rate REQUESTS_PER_SECOND]
+//              [--mix process:60,generate:20,memory:20] [--max-tokens N]
+//              [--expected-interval-ms MS] [--seed N]
+//
+// Each connection is a keep-alive socket driven by its own thread. Without
+// --rate the run is closed-loop: a connection sends its next request as soon
+// as the previous response arrives. With --rate the run is open-loop: the
+// total rate is split evenly across connections and every request has an
+// intended send time on a fixed schedule.
+//
+// Latency is reported corrected for coordinated omission. In open-loop runs
+// it is measured from the intended send time, so a stalled server is charged
+// for the requests that queued up behind the stall. Closed-loop runs cannot
+// see those requests, so each sample longer than the expected interval is
+// back-filled with the samples a steady client would have recorded
+// (HdrHistogram-style); the interval defaults to the measured median service
+// time. The service-time table is the raw send-to-response time.
+
+#include "metrics.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace BrainLLM;
+
+namespace {
+
+enum class Route {
+    Process,
+    Generate,
+    Memory
+};
+
+constexpr size_t kRouteCount = 3;
+constexpr const char* kRouteNames[kRouteCount] = {"/api/process", "/api/generate", "/api/memory"};
+
+const char* const kPrompts[] = {
+    "Hello, how are you today?",
+    "Explain how attention works in a neural network.",
+    "What is the capital of France?",
+    "Summarize the plot of a short story about a lighthouse keeper.",
+    "Write a haiku about autumn leaves.",
+    "List three uses for a quantum computer.",
+    "How does memory consolidation happen during sleep?",
+    "Translate good morning into Spanish."
+};
+
+const char* const kMemoryQueries[] = {
+    "hello", "attention", "memory", "language", "science", "music", "weather", "history"
+};
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int connections = 8;
+    double duration = 10.0;
+    double warmup = 1.0;
+    double rate = 0.0;                  // Requests per second; 0 selects closed-loop
+    int max_tokens = 16;
+    double expected_interval_ms = 0.0;  // Closed-loop correction; 0 uses the median
+    unsigned seed = 1;
+    unsigned weights[kRouteCount] = {60, 20, 20};
+};
+
+struct RouteStats {
+    Histogram latency;   // From intended send time
+    Histogram service;   // From actual send time
+    Counter ok;
+    Counter errors;
+};
+
+std::string json_escape(const char* text) {
+    std::string out;
+    for (const char* p = text; *p; ++p) {
+        if (*p == '"' || *p == '\\') out += '\\';
+        out += *p;
+    }
+    return out;
+}
+
+std::string url_encode(const char* text) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string out;
+    for (const char* p = text; *p; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+    }
+    return out;
+}
+
+std::string build_request(Route route, std::mt19937& rng, const LoadOptions& options) {
+    std::string body;
+    std::string target;
+    const char* method = "POST";
+    
+    switch (route) {
+        case Route::Process: {
+            const char* input = kPrompts[rng() % (sizeof(kPrompts) / sizeof(kPrompts[0]))];
+            target = "/api/process";
+            body = "{\"input\":\"" + json_escape(input) + "\"}";
+            break;
+        }
+        case Route::Generate: {
+            const char* prompt = kPrompts[rng() % (sizeof(kPrompts) / sizeof(kPrompts[0]))];
+            target = "/api/generate";
+            body = "{\"prompt\":\"" + json_escape(prompt) + "\",\"max_tokens\":" +
+                   std::to_string(options.max_tokens) + "}";
+            break;
+        }
+        case Route::Memory: {
+            const char* query = kMemoryQueries[rng() % (sizeof(kMemoryQueries) / sizeof(kMemoryQueries[0]))];
+            method = "GET";
+            target = "/api/memory?query=" + url_encode(query);
+            break;
+        }
+    }
+    
+    std::string request = std::string(method) + " " + target + " HTTP/1.1\r\nHost: " + options.host +
+                          "\r\nConnection: keep-alive\r\n";
+    if (!body.empty()) {
+        request += "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    request += "\r\n";
+    request += body;
+    return request;
+}
+
+// One blocking keep-alive connection. Responses are framed by
+// Content-Length, which both BrainLLM front ends always send.
+class Connection {
+public:
+    Connection(const LoadOptions& options) : options_(options), fd_(-1) {}
+    ~Connection() { close_socket(); }
+    
+    bool connect_socket() {
+        close_socket();
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd_ < 0) return false;
+        
+        int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        timeval timeout{30, 0};
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(options_.port));
+        if (inet_pton(AF_INET, options_.host.c_str(), &address.sin_addr) != 1 ||
+            ::connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close_socket();
+            return false;
+        }
+        buffer_.clear();
+        return true;
+    }
+    
+    // Sends one request and waits for its response; returns the HTTP status,
+    // or 0 when the connection failed and must be reopened
+    int round_trip(const std::string& request, uint64_t& sent_ns) {
+        if (fd_ < 0 && !connect_socket()) return 0;
+        
+        sent_ns = monotonic_nanoseconds();
+        size_t written = 0;
+        while (written < request.size()) {
+            ssize_t n = ::send(fd_, request.data() + written, request.size() - written, 0);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) continue;
+                close_socket();
+                return 0;
+            }
+            written += static_cast<size_t>(n);
+        }
+        
+        return read_response();
+    }
+    
+    void close_socket() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+private:
+    const LoadOptions& options_;
+    int fd_;
+    std::string buffer_;
+    
+    bool fill() {
+        char chunk[16 * 1024];
+        for (;;) {
+            ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+            if (n > 0) {
+                buffer_.append(chunk, static_cast<size_t>(n));
+                return true;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+    }
+    
+    int read_response() {
+        size_t head_end;
+        while ((head_end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) {
+                close_socket();
+                return 0;
+            }
+        }
+        
+        int status = 0;
+        if (buffer_.compare(0, 5, "HTTP/") != 0 ||
+            std::sscanf(buffer_.c_str() + buffer_.find(' '), " %d", &status) != 1) {
+            close_socket();
+            return 0;
+        }
+        
+        // Header names are matched case-insensitively
+        std::string head = buffer_.substr(0, head_end);
+        std::transform(head.begin(), head.end(), head.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        size_t content_length = 0;
+        size_t field = head.find("\r\ncontent-length:");
+        if (field != std::string::npos) {
+            content_length = std::strtoul(head.c_str() + field + 17, nullptr, 10);
+        }
+        bool close_after = head.find("\r\nconnection: close") != std::string::npos;
+        
+        size_t total = head_end + 4 + content_length;
+        while (buffer_.size() < total) {
+            if (!fill()) {
+                close_socket();
+                return 0;
+            }
+        }
+        buffer_.erase(0, total);
+        
+        if (close_after) close_socket();
+        return status;
+    }
+};
+
+void run_connection(int index, const LoadOptions& options, uint64_t start_ns, RouteStats* stats,
+                    std::atomic<uint64_t>& failures) {
+    std::mt19937 rng(options.seed + static_cast<unsigned>(index));
+    unsigned total_weight = options.weights[0] + options.weights[1] + options.weights[2];
+    
+    uint64_t measure_start = start_ns + static_cast<uint64_t>(options.warmup * 1e9);
+    uint64_t end = measure_start + static_cast<uint64_t>(options.duration * 1e9);
+    
+    // Open-loop schedule: connections are staggered across one interval
+    uint64_t interval = 0;
+    uint64_t next = start_ns;
+    if (options.rate > 0.0) {
+        interval = static_cast<uint64_t>(options.connections * 1e9 / options.rate);
+        next += interval * static_cast<uint64_t>(index) / static_cast<uint64_t>(options.connections);
+    }
+    
+    Connection connection(options);
+    for (;;) {
+        uint64_t now = monotonic_nanoseconds();
+        uint64_t intended = now;
+        if (interval > 0) {
+            intended = next;
+            next += interval;
+            if (intended >= end) break;
+            if (now < intended) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(intended - now));
+            }
+        } else if (now >= end) {
+            break;
+        }
+        
+        unsigned pick = rng() % total_weight;
+        size_t route = 0;
+        while (pick >= options.weights[route]) {
+            pick -= options.weights[route];
+            ++route;
+        }
+        
+        std::string request = build_request(static_cast<Route>(route), rng, options);
+        uint64_t sent = 0;
+        int status = connection.round_trip(request, sent);
+        uint64_t done = monotonic_nanoseconds();
+        
+        if (status == 0) {
+            failures.fetch_add(1, std::memory_order_relaxed);
+            // Back off briefly so a dead server does not spin the client
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        if (intended < measure_start) continue;
+        
+        RouteStats& route_stats = stats[route];
+        if (status >= 200 && status < 300) {
+            route_stats.ok.add();
+        } else {
+            route_stats.errors.add();
+        }
+        route_stats.latency.record(done - intended);
+        route_stats.service.record(done - sent);
+    }
+}
+
+// Adds the samples a closed-loop client missed while it waited on a slow
+// response: one per expected interval, at the latency each would have seen
+HistogramSnapshot correct_for_coordinated_omission(const HistogramSnapshot& raw, uint64_t interval) {
+    HistogramSnapshot corrected = raw;
+    if (interval == 0) return corrected;
+    
+    for (size_t i = 0; i < raw.buckets.size(); ++i) {
+        if (raw.buckets[i] == 0) continue;
+        uint64_t lower = Histogram::bucket_lower_bound(i);
+        uint64_t value = lower + (Histogram::bucket_upper_bound(i) - lower - 1) / 2;
+        
+        for (uint64_t missing = value; missing > interval; ) {
+            missing -= interval;
+            corrected.buckets[Histogram::bucket_index(missing)] += raw.buckets[i];
+            corrected.count += raw.buckets[i];
+            corrected.sum += missing * raw.buckets[i];
+        }
+    }
+    return corrected;
+}
+
+void merge_into(HistogramSnapshot& total, const HistogramSnapshot& part) {
+    if (total.buckets.empty()) total.buckets.assign(part.buckets.size(), 0);
+    for (size_t i = 0; i < part.buckets.size(); ++i) {
+        total.buckets[i] += part.buckets[i];
+    }
+    total.count += part.count;
+    total.sum += part.sum;
+}
+
+void print_table(const char* title, const std::vector<std::string>& names,
+                 const std::vector<HistogramSnapshot>& snapshots, const std::vector<uint64_t>& requests,
+                 const std::vector<uint64_t>& errors, double seconds) {
+    std::printf("\n%s\n", title);
+    std::printf("%-16s %10s %8s %10s %10s %10s %10s %10s\n",
+                "route", "requests", "errors", "req/s", "p50 ms", "p99 ms", "p999 ms", "max ms");
+    for (size_t i = 0; i < names.size(); ++i) {
+        const HistogramSnapshot& snapshot = snapshots[i];
+        std::printf("%-16s %10llu %8llu %10.1f %10.3f %10.3f %10.3f %10.3f\n",
+                    names[i].c_str(),
+                    static_cast<unsigned long long>(requests[i]),
+                    static_cast<unsigned long long>(errors[i]),
+                    requests[i] / seconds,
+                    snapshot.percentile(0.50) / 1e6,
+                    snapshot.percentile(0.99) / 1e6,
+                    snapshot.percentile(0.999) / 1e6,
+                    snapshot.percentile(1.0) / 1e6);
+    }
+}
+
+bool parse_mix(const char* text, LoadOptions& options) {
+    unsigned weights[kRouteCount] = {0, 0, 0};
+    std::string mix = text;
+    size_t pos = 0;
+    while (pos < mix.size()) {
+        size_t comma = mix.find(',', pos);
+        std::string entry = mix.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? mix.size() : comma + 1;
+        
+        size_t colon = entry.find(':');
+        if (colon == std::string::npos) return false;
+        std::string name = "/api/" + entry.substr(0, colon);
+        
+        size_t route = 0;
+        while (route < kRouteCount && name != kRouteNames[route]) ++route;
+        if (route == kRouteCount) return false;
+        weights[route] = static_cast<unsigned>(std::atoi(entry.c_str() + colon + 1));
+    }
+    
+    if (weights[0] + weights[1] + weights[2] == 0) return false;
+    std::copy(weights, weights + kRouteCount, options.weights);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--host") == 0 && has_value) {
+            options.host = argv[++i];
+        } else if (std::strcmp(argv[i], "--port") == 0 && has_value) {
+            options.port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--connections") == 0 && has_value) {
+            options.connections = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--duration") == 0 && has_value) {
+            options.duration = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && has_value) {
+            options.warmup = std::max(0.0, std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--rate") == 0 && has_value) {
+            options.rate = std::max(0.0, std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--mix") == 0 && has_value) {
+            if (!parse_mix(argv[++i], options)) {
+                std::cerr << "Invalid --mix; expected e.g. process:60,generate:20,memory:20" << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--max-tokens") == 0 && has_value) {
+            options.max_tokens = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--expected-interval-ms") == 0 && has_value) {
+            options.expected_interval_ms = std::max(0.0, std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && has_value) {
+            options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::cerr << "Usage: brain_load [--host ADDR] [--port N] [--connections N] [--duration SECONDS]\n"
+                         "                  [--warmup SECONDS] [--rate RPS] [--mix process:W,generate:W,memory:W]\n"
+                         "                  [--max-tokens N] [--expected-interval-ms MS] [--seed N]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (options.duration <= 0.0) {
+        std::cerr << "--duration must be positive" << std::endl;
+        return 1;
+    }
+    
+    // A server closing mid-write must surface as an error, not kill the client
+    signal(SIGPIPE, SIG_IGN);
+    
+    bool open_loop = options.rate > 0.0;
+    char mode[64] = "closed-loop";
+    if (open_loop) std::snprintf(mode, sizeof(mode), "open-loop at %.0f req/s", options.rate);
+    std::printf("brain_load: %s:%d, %d connections, %.1fs (+%.1fs warm-up), %s\n",
+                options.host.c_str(), options.port, options.connections, options.duration, options.warmup, mode);
+    
+    auto stats = std::make_unique<RouteStats[]>(kRouteCount);
+    std::atomic<uint64_t> failures{0};
+    uint64_t start = monotonic_nanoseconds();
+    
+    std::vector<std::thread> threads;
+    threads.reserve(options.connections);
+    for (int i = 0; i < options.connections; ++i) {
+        threads.emplace_back(run_connection, i, std::cref(options), start, stats.get(), std::ref(failures));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    // Open-loop runs can overrun the schedule; throughput is over actual time
+    double seconds = std::max(options.duration,
+                              (monotonic_nanoseconds() - start) / 1e9 - options.warmup);
+    
+    std::vector<std::string> names;
+    std::vector<HistogramSnapshot> service;
+    std::vector<HistogramSnapshot> latency;
+    std::vector<uint64_t> requests;
+    std::vector<uint64_t> errors;
+    HistogramSnapshot service_total;
+    HistogramSnapshot latency_total;
+    uint64_t error_total = 0;
+    
+    for (size_t i = 0; i < kRouteCount; ++i) {
+        if (options.weights[i] == 0) continue;
+        names.push_back(kRouteNames[i]);
+        service.push_back(stats[i].service.snapshot());
+        latency.push_back(stats[i].latency.snapshot());
+        requests.push_back(stats[i].ok.value() + stats[i].errors.value());
+        errors.push_back(stats[i].errors.value());
+        merge_into(service_total, service.back());
+        error_total += errors.back();
+    }
+    
+    if (!open_loop) {
+        // Correct every route with one interval: the client's expected pacing
+        uint64_t interval = options.expected_interval_ms > 0.0
+            ? static_cast<uint64_t>(options.expected_interval_ms * 1e6)
+            : service_total.percentile(0.50);
+        for (size_t i = 0; i < latency.size(); ++i) {
+            latency[i] = correct_for_coordinated_omission(service[i], interval);
+        }
+    }
+    for (const auto& snapshot : latency) {
+        merge_into(latency_total, snapshot);
+    }
+    
+    names.push_back("all");
+    service.push_back(service_total);
+    latency.push_back(latency_total);
+    requests.push_back(std::accumulate(requests.begin(), requests.end(), uint64_t{0}));
+    errors.push_back(error_total);
+    
+    print_table(open_loop ? "Latency from intended send time (coordinated-omission corrected)"
+                          : "Latency corrected for coordinated omission",
+                names, latency, requests, errors, seconds);
+    print_table("Service time (send to response)", names, service, requests, errors, seconds);
+    
+    std::printf("\nThroughput: %.1f req/s over %.1fs", requests.back() / seconds, seconds);
+    if (failures.load() > 0) {
+        std::printf(", %llu connection failures", static_cast<unsigned long long>(failures.load()));
+    }
+    std::printf("\n");
+    
+    return requests.back() > 0 ? 0 : 1;
+}
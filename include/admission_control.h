@@ -0,0 +1,85 @@
+#pragma once
+
+#include "http_parser.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace BrainLLM {
+
+struct AdmissionPolicy {
+    int max_connections = 100;          // Open connections; 0 means unlimited
+    std::string api_key;                // Required on every request when non-empty
+    double requests_per_second = 0.0;   // Token refill rate per client; 0 disables limiting
+    double burst = 20.0;                // Bucket capacity, the largest allowed burst
+    size_t max_queued_requests = 256;   // Admitted requests waiting for a worker
+    uint64_t deadline_ms = 5000;        // Longest acceptable queue wait; 0 disables shedding
+    int workers = 1;                    // Requests served concurrently, for wait estimates
+};
+
+// Decides whether a front end should take on a connection or a request
+// before any work is done for it, so overload turns into fast 429/503
+// replies instead of unbounded latency for every client.
+//
+// Requests are rate limited with one token bucket per client address. The
+// presented key never selects the bucket: unchecked keys could be varied
+// for a fresh bucket per request, and the one configured key is shared by
+// every client. Admitted requests count as queued until a worker starts
+// them; a request is shed when the queue is full or when the expected wait
+// (queued requests times the smoothed service time, spread over the
+// workers) already exceeds the deadline, and again when a worker finds it
+// has waited longer than the deadline.
+class AdmissionController {
+public:
+    enum class Decision {
+        Admit,
+        Unauthorized,   // 401: missing or wrong API key
+        RateLimited,    // 429: the client's bucket is empty
+        Overloaded      // 503: the queue cannot serve it within the deadline
+    };
+    
+    explicit AdmissionController(const AdmissionPolicy& policy = AdmissionPolicy());
+    
+    void set_policy(const AdmissionPolicy& policy);
+    AdmissionPolicy get_policy() const;
+    
+    // Every successful acquire_connection() must be paired with a release
+    bool acquire_connection();
+    void release_connection();
+    
+    // retry_after_seconds is set for RateLimited and Overloaded
+    Decision admit(const HttpRequest& request, const std::string& client_address, int& retry_after_seconds);
+    
+    // A worker picked up a request admitted at enqueued_ns; returns false
+    // when it has already waited past the deadline and should be shed
+    bool start(uint64_t enqueued_ns);
+    void finish(uint64_t service_ns);
+    
+    size_t get_connection_count() const;
+    size_t get_queued_count() const;
+
+private:
+    struct TokenBucket {
+        double tokens;
+        uint64_t updated_ns;
+    };
+    
+    static constexpr size_t kMaxTrackedClients = 10000;
+    
+    mutable std::mutex mutex_;
+    AdmissionPolicy policy_;
+    std::unordered_map<std::string, TokenBucket> buckets_;
+    size_t connections_;
+    size_t queued_;
+    double service_ns_;   // Exponentially smoothed service time of one request
+    
+    bool authorized(const std::string& presented_key) const;
+    bool take_token(const std::string& client, uint64_t now, int& retry_after_seconds);
+    void prune_buckets(uint64_t now);
+    
+    static std::string presented_key(const HttpRequest& request);
+};
+
+} // namespace BrainLLM
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "brain_types.h"
+#include "tokenizer.h"
+#include "tensor_storage.h"
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
 
 namespace BrainLLM {
 
@@ -63,26 +66,52 @@ private:
 
 class EmbeddingLayer {
 public:
-    EmbeddingLayer(int vocab_size, int embedding_dim);
+    EmbeddingLayer(int vocab_size, int embedding_dim,
+                   StoragePrecision precision = StoragePrecision::Float32);
     ~EmbeddingLayer() = default;
     
     // Embedding operations
-    std::vector<float> embed_token(int token_id);
+    std::vector<float> embed_token(int token_id) const;
     std::vector<int> tokenize(const std::string& text);
     std::string detokenize(const std::vector<int>& tokens);
     
+    // Row of the table for one token, without copying. Empty for ids
+    // outside the vocabulary and for half-precision tables, which have no
+    // fp32 row to point at; gather() works for every precision.
+    FloatSpan lookup(int token_id) const;
+    
+    // Writes one embedding_dim row per token to out, back to back; unknown
+    // ids produce zero rows
+    void gather(const std::vector<int>& tokens, float* out) const;
+    std::vector<float> embed_sequence(const std::vector<int>& tokens) const;
+    
+    // Use a trained BPE vocabulary instead of raw bytes; ids at or beyond
+    // vocab_size embed as zero vectors
+    void set_tokenizer(std::shared_ptr<const BpeTokenizer> tokenizer);
+    
     // Position encoding
     std::vector<float> get_positional_encoding(int position, int dim);
     
-    // Learn embeddings
+    // Learn embeddings: gradients hold one embedding_dim row per token
     void update_embeddings(const std::vector<int>& tokens,
-                          const std::vector<float>& gradients);
+                          const std::vector<float>& gradients,
+                          float learning_rate = 0.01f);
+    
+    int get_vocab_size() const { return vocab_size_; }
+    int get_embedding_dim() const { return embedding_dim_; }
+    StoragePrecision get_precision() const { return precision_; }
+    size_t memory_bytes() const;
     
 private:
     int vocab_size_;
     int embedding_dim_;
-    std::map<int, std::vector<float>> embedding_matrix_;
+    StoragePrecision precision_;
+    size_t row_stride_;                 // Elements per row, padded to whole cache lines
+    AlignedVector<float> table_;        // [vocab_size x row_stride] when stored as fp32
+    AlignedVector<uint16_t> half_table_;  // Same layout for fp16/bf16 storage
+    std::shared_ptr<const BpeTokenizer> tokenizer_;
     
+    bool valid_token(int token_id) const { return token_id >= 0 && token_id < vocab_size_; }
     void initialize_embeddings();
 };
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "tensor_storage.h"
 #include <vector>
 #include <string>
 #include <map>
@@ -88,6 +89,38 @@ struct BrainConfig {
     // Processing
     int batch_size;
     float temperature;
+    
+    // Speculative decoding: a draft network with draft_layers layers
+    // proposes speculative_tokens tokens per step; 0 disables it
+    int speculative_tokens;
+    int draft_layers;
+    
+    // Training keeps the activations of every activation_checkpoint_interval-th
+    // layer and recomputes the rest during backpropagation; 1 keeps all,
+    // 0 picks about sqrt(num_layers)
+    int activation_checkpoint_interval;
+    
+    // Element type the network's weights are stored in; arithmetic is
+    // always fp32
+    StoragePrecision weight_precision;
+};
+
+// Per-request generation parameters
+struct GenerationOptions {
+    int max_tokens = 100;
+    float temperature = -1.0f;        // Negative means use BrainConfig::temperature
+    int top_k = 0;                    // 0 considers the whole vocabulary
+    float top_p = 1.0f;               // 1 disables nucleus filtering
+    float repetition_penalty = 1.0f;  // 1 disables the penalty
+    uint64_t seed = 0;                // 0 draws a fresh seed; otherwise output is reproducible
+    std::string session_id;           // Session the exchange is recorded in; empty for the default
+};
+
+// One decoded position from a generation step
+struct DecodedToken {
+    char symbol;
+    float score;
+    bool end_of_sequence;
 };
 
 // Brain State
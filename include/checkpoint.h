@@ -0,0 +1,97 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace BrainLLM {
+
+// One named weight matrix, stored row-major
+struct CheckpointTensor {
+    std::string name;
+    uint32_t rows = 0;
+    uint32_t cols = 0;
+    std::vector<float> data;
+};
+
+// Everything needed to resume training: the weights of every network and
+// the optimizer's position. Plain SGD keeps no per-weight state, so the
+// step count is the whole optimizer state.
+struct Checkpoint {
+    uint64_t step = 0;
+    std::vector<CheckpointTensor> tensors;
+    
+    // Tensor with this name, or null
+    const CheckpointTensor* find(const std::string& name) const;
+    
+    // Files hold a header, each tensor's name, shape and floats (host byte
+    // order), and a trailing FNV-1a checksum of everything before it.
+    // write() returns once the data has been fsynced.
+    bool write(const std::string& path) const;
+    bool read(const std::string& path);
+};
+
+// Writes checkpoints on a background thread so the training loop only pays
+// for copying weights into a staging buffer. Each file is written to a
+// temporary name, fsynced and renamed into place, so a crash leaves either
+// the previous checkpoint or the new one, never a torn file. Only the
+// newest keep_last checkpoints are retained.
+//
+// At most one checkpoint waits behind the one being written; submitting
+// another replaces it, so a slow disk drops intermediate checkpoints
+// instead of stalling training. Staging buffers are recycled.
+class CheckpointWriter {
+public:
+    struct Stats {
+        uint64_t written = 0;
+        uint64_t superseded = 0;   // Replaced by a newer checkpoint before being written
+        uint64_t failed = 0;
+        std::string last_path;     // Most recent checkpoint on disk
+    };
+    
+    CheckpointWriter(const std::string& directory, size_t keep_last = 3);
+    ~CheckpointWriter();
+    
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    
+    // A recycled checkpoint whose tensor storage can be refilled in place
+    Checkpoint take_buffer();
+    void submit(Checkpoint checkpoint);
+    
+    // Blocks until every submitted checkpoint is on disk
+    void flush();
+    
+    Stats get_stats() const;
+    const std::string& get_directory() const { return directory_; }
+    
+    // Newest complete checkpoint in directory, or an empty string
+    static std::string find_latest(const std::string& directory);
+
+private:
+    std::string directory_;
+    size_t keep_last_;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable idle_;
+    bool running_;
+    bool writing_;
+    bool has_pending_;
+    Checkpoint pending_;
+    std::vector<Checkpoint> spare_;
+    Stats stats_;
+    std::thread thread_;
+    
+    void run();
+    bool write_checkpoint(const Checkpoint& checkpoint, std::string& path);
+    void prune();
+    static std::vector<std::pair<uint64_t, std::string>> list_checkpoints(const std::string& directory);
+};
+
+} // namespace BrainLLM
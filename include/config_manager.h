@@ -11,7 +11,10 @@ public:
     ConfigManager();
     ~ConfigManager() = default;
     
-    // Configuration loading/saving
+    // Configuration loading/saving. load_config() reads the INI layout of
+    // config.ini ([section] headers, key=value lines, # comments) or the JSON
+    // that save_config() writes; unknown keys are ignored and a malformed
+    // value makes it return false after applying the rest.
     bool load_config(const std::string& filepath);
     bool save_config(const std::string& filepath);
     
@@ -39,6 +42,10 @@ public:
         bool enable_cors;
         int max_connections;
         std::string api_key;
+        float requests_per_second;   // Per client; 0 disables rate limiting
+        int burst;
+        int max_queued_requests;
+        int request_deadline_ms;     // Longest queue wait before a request is shed
     };
     
     APISettings get_api_settings() const;
@@ -60,6 +67,8 @@ private:
     std::string log_level_;
     
     bool parse_json(const std::string& json_content);
+    bool parse_ini(const std::string& ini_content);
+    bool apply_setting(const std::string& section, const std::string& key, const std::string& value);
     std::string to_json() const;
 };
 
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "tokenizer.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace BrainLLM {
+
+// Read-only view of a whole file. Uses mmap where available, so the pages
+// of a multi-gigabyte corpus are faulted in as they are read and dropped by
+// the kernel under pressure instead of being copied into the heap.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    bool open(const std::string& path);
+    void close();
+    
+    std::string_view view() const { return std::string_view(data_, size_); }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::string fallback_;  // File contents where mmap is unavailable
+};
+
+enum class CorpusFormat {
+    Text,       // Each non-empty line is a document
+    JsonLines   // Each line is a JSON object; its text field is the document
+};
+
+struct DataLoaderOptions {
+    std::vector<std::string> paths;
+    CorpusFormat format = CorpusFormat::Text;
+    std::string text_field = "text";
+    
+    size_t sequence_length = 256;     // Tokens per packed sequence
+    size_t batch_size = 32;           // Sequences per batch
+    size_t shuffle_window = 4096;     // Sequences drawn from at random; 1 disables shuffling
+    size_t worker_threads = 2;        // Tokenizer threads
+    size_t chunk_bytes = 4 << 20;     // Corpus bytes per unit of tokenizer work
+    uint64_t seed = 0;                // 0 draws a fresh seed
+    bool repeat = false;              // Start another epoch when the corpus runs out
+};
+
+// Fixed-size packed sequences, stored row-major in one buffer
+struct TokenBatch {
+    size_t sequence_length = 0;
+    size_t count = 0;
+    std::vector<int> tokens;  // count * sequence_length ids
+    
+    const int* sequence(size_t index) const { return tokens.data() + index * sequence_length; }
+};
+
+// Streaming training input. Corpus files are memory-mapped and cut into
+// newline-aligned chunks; worker threads tokenize chunks in parallel and
+// pack the documents, separated by a newline token, into sequences of
+// exactly sequence_length tokens. Sequences pass through a shuffle window
+// and an assembler thread groups them into batches, keeping up to
+// kPrefetchBatches ready so the trainer takes a finished batch while the
+// next one fills.
+//
+// Only the window and the prefetched batches live in memory, whatever the
+// corpus size; producers block when the window is full. Buffers circulate
+// between stages instead of being reallocated. Each worker drops the tail
+// of its last sequence that is shorter than sequence_length.
+class DataLoader {
+public:
+    static constexpr size_t kPrefetchBatches = 2;
+    
+    struct Stats {
+        uint64_t bytes = 0;           // Corpus bytes tokenized
+        uint64_t documents = 0;
+        uint64_t sequences = 0;       // Packed sequences produced
+        uint64_t batches = 0;         // Batches handed to the trainer
+        uint64_t trainer_waits = 0;   // next_batch() calls that found no batch ready
+    };
+    
+    DataLoader(const DataLoaderOptions& options, std::shared_ptr<const BpeTokenizer> tokenizer);
+    ~DataLoader();
+    
+    DataLoader(const DataLoader&) = delete;
+    DataLoader& operator=(const DataLoader&) = delete;
+    
+    // Maps the corpus and starts the pipeline; false (see error()) if a
+    // file cannot be read or the options are unusable
+    bool start();
+    void stop();
+    
+    // Blocks until a batch is ready and swaps it into batch, whose old
+    // storage is recycled. Returns false once the corpus is exhausted; the
+    // final batch may hold fewer than batch_size sequences.
+    bool next_batch(TokenBatch& batch);
+    
+    Stats get_stats() const;
+    const std::string& error() const { return error_; }
+
+private:
+    struct Chunk {
+        size_t file;
+        size_t begin;
+        size_t end;
+    };
+    
+    DataLoaderOptions options_;
+    std::shared_ptr<const BpeTokenizer> tokenizer_;
+    std::vector<std::unique_ptr<MappedFile>> files_;
+    std::vector<Chunk> chunks_;
+    std::atomic<size_t> next_chunk_;
+    std::string error_;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable window_space_;
+    std::condition_variable window_ready_;
+    std::condition_variable batch_space_;
+    std::condition_variable batch_ready_;
+    bool running_;
+    size_t active_workers_;
+    std::mt19937_64 rng_;
+    
+    std::vector<std::vector<int>> window_;   // Sequences waiting to be drawn
+    std::vector<std::vector<int>> spare_;    // Emptied sequence buffers
+    std::vector<TokenBatch> ready_;          // Batches for the trainer, oldest first
+    std::vector<TokenBatch> spare_batches_;
+    bool batches_done_;
+    Stats stats_;
+    
+    std::vector<std::thread> workers_;
+    std::thread assembler_;
+    
+    void split_chunks();
+    void work();
+    void assemble();
+    bool claim_chunk(Chunk& chunk);
+    size_t tokenize_chunk(const Chunk& chunk, std::vector<int>& packed);
+    bool emit_sequences(std::vector<int>& packed);
+};
+
+} // namespace BrainLLM
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "llm_engine.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace BrainLLM {
+
+// Iteration-level scheduler for concurrent generation requests. A single
+// decode thread advances every active sequence by one token per step with
+// one batched forward pass. Waiting requests are admitted between steps and
+// finished sequences retire immediately, so short requests never wait for
+// long ones to drain.
+//
+// Admission is FIFO and bounded by two budgets: the number of sequences in
+// a step (max_batch_size) and the total tokens reserved by active sequences
+// (max_batch_tokens, the sum of their max_tokens). The head of the queue is
+// never overtaken, so a large request cannot be starved by small ones.
+class DecodeScheduler {
+public:
+    DecodeScheduler(std::shared_ptr<LLMEngine> engine, size_t max_batch_size = 32,
+                    size_t max_batch_tokens = 32768);
+    ~DecodeScheduler();
+    
+    DecodeScheduler(const DecodeScheduler&) = delete;
+    DecodeScheduler& operator=(const DecodeScheduler&) = delete;
+    
+    void start();
+    void stop();
+    bool is_running() const;
+    
+    // Queue a request; the future resolves when its sequence finishes
+    std::future<std::string> submit(const std::string& prompt, const GenerationOptions& options);
+    
+    // Blocking convenience wrapper around submit()
+    std::string generate(const std::string& prompt, const GenerationOptions& options);
+    
+    size_t get_active_count() const;
+    size_t get_queued_count() const;
+
+private:
+    struct Sequence {
+        std::string prompt;
+        std::string response;
+        GenerationOptions options;
+        Sampler sampler;
+        int generated = 0;
+        size_t reserved = 0;  // Tokens charged against max_batch_tokens
+        std::promise<std::string> result;
+    };
+    
+    std::shared_ptr<LLMEngine> engine_;
+    size_t max_batch_size_;
+    size_t max_batch_tokens_;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::deque<std::unique_ptr<Sequence>> queue_;
+    bool running_;
+    std::thread thread_;
+    
+    // Owned by the decode thread; contexts_[i] is prompt + response of active_[i]
+    std::vector<std::unique_ptr<Sequence>> active_;
+    std::vector<std::string> contexts_;
+    std::vector<Sampler*> samplers_;  // samplers_[i] belongs to active_[i] during a step
+    size_t reserved_tokens_;
+    std::atomic<size_t> active_count_;  // Mirror of active_.size() for other threads
+    
+    void run();
+    void admit(std::vector<std::unique_ptr<Sequence>>& admitted);
+    void step();
+    void retire(size_t index);
+    void set_active_count(size_t count);
+};
+
+} // namespace BrainLLM
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "request_handler.h"
+#include "http_parser.h"
+#include "admission_control.h"
+#include "config_manager.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace BrainLLM {
+
+// Native Linux HTTP front end for the headless API binary. Runs one
+// edge-triggered epoll loop per thread, each with its own SO_REUSEPORT
+// listening socket so the kernel spreads connections across loops.
+// Loops only frame requests with HttpParser and write responses; the
+// RequestHandler runs on a shared worker pool so a slow inference never
+// stalls the other connections on its loop. Workers post finished
+// responses back to the owning loop through its eventfd, and the loop
+// writes them in request order with writev so bodies are never copied
+// into a header buffer. Connections and requests pass the same
+// AdmissionController checks as RestServer before any work is queued.
+class EpollServer {
+public:
+    EpollServer(std::shared_ptr<RequestHandler> handler, int port = 8080, int num_threads = 0,
+                int num_workers = 0);
+    ~EpollServer();
+    
+    EpollServer(const EpollServer&) = delete;
+    EpollServer& operator=(const EpollServer&) = delete;
+    
+    bool start();
+    void stop();
+    bool is_running() const;
+    
+    void set_api_settings(const ConfigManager::APISettings& settings);
+    
+    int get_thread_count() const { return num_threads_; }
+    int get_worker_count() const { return num_workers_; }
+
+private:
+    struct PendingResponse {
+        int status_code = 200;
+        std::string body;
+        const char* content_type = "application/json";
+        bool keep_alive = true;
+        int retry_after_seconds = 0;
+    };
+    
+    // Requests on a keep-alive connection are answered in the order they
+    // were received, whatever order the workers finish them in
+    struct Connection {
+        int fd;
+        uint64_t id = 0;
+        std::string client_address;         // Identifies the client for rate limiting
+        HttpParser parser;
+        std::deque<std::string> out_queue;  // Pending header/body segments
+        size_t out_offset = 0;              // Bytes of out_queue.front() already sent
+        std::vector<std::string> spare_buffers;  // Sent segments kept for their capacity
+        bool closing = false;               // No further requests will be parsed
+        bool peer_closed = false;
+        uint64_t next_sequence = 0;         // Assigned to the next parsed request
+        uint64_t next_to_write = 0;         // Sequence of the next response to send
+        std::map<uint64_t, PendingResponse> completed;
+    };
+    
+    struct EventLoop;
+    
+    // A finished response on its way back to the loop that owns the
+    // connection; the id guards against the fd having been reused
+    struct Completion {
+        int fd;
+        uint64_t connection_id;
+        uint64_t sequence;
+        PendingResponse response;
+    };
+    
+    struct Job {
+        EventLoop* loop;
+        int fd;
+        uint64_t connection_id;
+        uint64_t sequence;
+        HttpRequest request;
+        std::string buffer;  // Recycled body buffer from the connection
+        uint64_t enqueued_ns;
+    };
+    
+    struct EventLoop {
+        int listen_fd = -1;
+        int epoll_fd = -1;
+        int wake_fd = -1;   // Signalled by stop() and by workers posting completions
+        std::thread thread;
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        uint64_t next_connection_id = 1;
+        
+        std::mutex completions_mutex;
+        std::vector<Completion> completions;
+    };
+    
+    // Requests in flight per connection before parsing and reading pause
+    static constexpr uint64_t kMaxPipelinedRequests = 16;
+    
+    std::shared_ptr<RequestHandler> handler_;
+    int port_;
+    int num_threads_;
+    int num_workers_;
+    std::atomic<bool> running_;
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    AdmissionController admission_;
+    
+    std::mutex jobs_mutex_;
+    std::condition_variable jobs_ready_;
+    std::deque<Job> jobs_;
+    bool stopping_workers_;
+    std::vector<std::thread> workers_;
+    
+    bool open_loop(EventLoop& loop);
+    void close_loop(EventLoop& loop);
+    void run_loop(EventLoop& loop);
+    void run_worker();
+    
+    void accept_connections(EventLoop& loop);
+    void close_connection(EventLoop& loop, int fd);
+    bool service_connection(EventLoop& loop, Connection& connection);
+    bool read_connection(EventLoop& loop, Connection& connection);
+    void handle_requests(EventLoop& loop, Connection& connection);
+    void dispatch(EventLoop& loop, Connection& connection, uint64_t sequence, HttpRequest request);
+    void post_completion(EventLoop& loop, Completion completion);
+    void drain_completions(EventLoop& loop);
+    void write_completed(Connection& connection);
+    bool flush_connection(Connection& connection);
+    std::string take_spare_buffer(Connection& connection);
+    void queue_response(Connection& connection, PendingResponse response);
+    
+    static PendingResponse rejection(AdmissionController::Decision decision, int retry_after_seconds,
+                                     bool keep_alive);
+};
+
+} // namespace BrainLLM
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <cstddef>
+
+namespace BrainLLM {
+
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    std::string version;
+    std::string body;
+    std::map<std::string, std::string> headers;  // Keys are lower-cased
+    bool keep_alive = true;
+    
+    std::string header(const std::string& name) const;
+};
+
+// Status line and headers for a response, shared by the HTTP front ends.
+// A positive retry_after_seconds adds a Retry-After header (429/503).
+std::string http_response_head(int status_code, size_t content_length, bool keep_alive,
+                               const char* content_type = "application/json", int retry_after_seconds = 0);
+const char* http_status_text(int status_code);
+
+// Incremental HTTP/1.1 request parser. One instance lives per connection:
+// bytes are appended as they arrive and complete requests are pulled out
+// one at a time, so partial reads and pipelined requests are both handled.
+class HttpParser {
+public:
+    enum class Result {
+        Complete,   // A request was written to the output argument
+        NeedMore,   // Buffer holds only part of a request
+        Error       // Malformed or oversized request; see error_status()
+    };
+    
+    HttpParser(size_t max_header_bytes = 64 * 1024, size_t max_body_bytes = 8 * 1024 * 1024);
+    
+    void feed(const char* data, size_t size);
+    Result next(HttpRequest& request);
+    void reset();
+    
+    int error_status() const { return error_status_; }
+    size_t buffered_bytes() const { return buffer_.size() - read_pos_; }
+
+private:
+    enum class Stage {
+        Head,
+        Body,
+        ChunkSize,
+        ChunkData,
+        ChunkTrailer
+    };
+    
+    std::string buffer_;
+    size_t read_pos_;
+    Stage stage_;
+    HttpRequest current_;
+    size_t body_remaining_;
+    size_t max_header_bytes_;
+    size_t max_body_bytes_;
+    int error_status_;
+    
+    Result parse_head();
+    Result parse_body();
+    Result parse_chunked();
+    Result fail(int status);
+    void compact();
+    bool read_line(std::string& line);
+};
+
+} // namespace BrainLLM
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace BrainLLM {
+
+class JsonReader;
+
+// Lightweight view of one value inside a parsed document. Nothing is
+// materialized until a getter is called, and views stay valid for as long
+// as the reader and the input text do.
+class JsonValue {
+public:
+    enum class Type {
+        Invalid,
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+    
+    JsonValue() : reader_(nullptr), token_(0) {}
+    
+    Type type() const;
+    bool is_valid() const { return type() != Type::Invalid; }
+    bool is_string() const { return type() == Type::String; }
+    bool is_number() const { return type() == Type::Number; }
+    bool is_array() const { return type() == Type::Array; }
+    bool is_object() const { return type() == Type::Object; }
+    
+    // Object member lookup; returns an invalid value when absent
+    JsonValue operator[](std::string_view key) const;
+    
+    // Array elements (or object values) by position
+    size_t size() const;
+    JsonValue at(size_t index) const;
+    
+    // Linear walk over an array: first() is the first element and next()
+    // the following sibling; both return an invalid value past the end
+    JsonValue first() const;
+    JsonValue next() const;
+    
+    // Scalar accessors return the fallback when the type does not match
+    std::string as_string(const std::string& fallback = std::string()) const;
+    double as_double(double fallback = 0.0) const;
+    int64_t as_int(int64_t fallback = 0) const;
+    bool as_bool(bool fallback = false) const;
+    
+    // Raw source text of the value, including quotes for strings
+    std::string_view raw() const;
+
+private:
+    friend class JsonReader;
+    
+    JsonValue(const JsonReader* reader, uint32_t token) : reader_(reader), token_(token) {}
+    
+    const JsonReader* reader_;
+    uint32_t token_;
+};
+
+// On-demand JSON parser. parse() runs a single indexing pass that records
+// the offset of every structural character and scalar, pairing each
+// bracket with its closing token so containers can be skipped in O(1).
+// String contents are skipped 16 bytes at a time with SSE2. No DOM is
+// built; values are decoded only when accessed. Reusing a reader reuses
+// its index storage.
+class JsonReader {
+public:
+    JsonReader() = default;
+    
+    bool parse(std::string_view json);
+    JsonValue root() const;
+    const std::string& error() const { return error_; }
+
+private:
+    friend class JsonValue;
+    
+    std::string_view json_;
+    std::vector<uint32_t> offsets_;    // Byte offset of each token
+    std::vector<uint32_t> matching_;   // For '{' / '[' tokens, index of the closing token
+    std::vector<uint32_t> open_stack_;
+    std::string error_;
+    
+    bool fail(const char* message, size_t offset);
+    uint32_t skip(uint32_t token) const;
+    char token_char(uint32_t token) const { return json_[offsets_[token]]; }
+    std::string_view scalar_text(uint32_t token) const;
+    static bool unescape(std::string_view quoted, std::string& out);
+};
+
+} // namespace BrainLLM
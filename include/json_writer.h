@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace BrainLLM {
+
+// Streaming JSON serializer that appends straight into a caller-owned
+// buffer. It never allocates on its own; reusing a buffer whose capacity
+// has already grown makes serialization allocation-free. Strings are
+// escaped with an SSE2 fast path that skips runs of plain ASCII, and
+// invalid UTF-8 is replaced with U+FFFD so the output is always valid.
+// Numbers use std::to_chars, which is locale-independent and shortest
+// round-trip.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out);
+    
+    JsonWriter& begin_object();
+    JsonWriter& end_object();
+    JsonWriter& begin_array();
+    JsonWriter& end_array();
+    
+    JsonWriter& key(std::string_view name);
+    
+    JsonWriter& value(std::string_view text);
+    JsonWriter& value(const char* text);
+    JsonWriter& value(float number);
+    JsonWriter& value(double number);
+    JsonWriter& value(int number);
+    JsonWriter& value(int64_t number);
+    JsonWriter& value(uint64_t number);
+    JsonWriter& value(bool flag);
+    JsonWriter& null_value();
+    
+    // Shorthand for key(name).value(v)
+    template <typename T>
+    JsonWriter& field(std::string_view name, T v) {
+        key(name);
+        return value(v);
+    }
+    
+    std::string& buffer() { return out_; }
+    
+    static void append_escaped(std::string& out, std::string_view text);
+    static void append_number(std::string& out, double number);
+    static void append_number(std::string& out, float number);
+
+private:
+    static constexpr int kMaxDepth = 64;
+    
+    std::string& out_;
+    uint64_t has_elements_;  // Bit per nesting level: container already has an element
+    int depth_;
+    bool after_key_;
+    
+    void separator();
+    void push();
+    void pop();
+};
+
+} // namespace BrainLLM
@@ -4,24 +4,80 @@
 #include "neural_network.h"
 #include "memory_system.h"
 #include "attention_mechanism.h"
+#include "metrics.h"
+#include "tokenizer.h"
+#include "sampler.h"
+#include "prefix_cache.h"
+#include "session_pool.h"
+#include "data_loader.h"
+#include "checkpoint.h"
 #include <string>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 
 namespace BrainLLM {
 
+// All public methods are safe to call concurrently, so callers such as the
+// REST worker pool may share a single instance across threads. The model
+// (weights, tokenizer, configuration) sits behind a reader-writer lock:
+// inference takes it shared and runs in parallel, while training,
+// configuration changes and tokenizer loads take it exclusively.
+//
+// Per-conversation state (context, confidence, dialogue history) lives in a
+// session pool keyed by session id rather than on the engine, so concurrent
+// requests never clobber each other's context. The empty id names a default
+// session for callers that do not track sessions.
 class LLMEngine {
 public:
     LLMEngine(const BrainConfig& config);
     ~LLMEngine() = default;
     
     // Core LLM operations
-    std::string process_input(const std::string& input);
+    std::string process_input(const std::string& input, const std::string& session_id = std::string());
+    std::vector<std::string> process_batch(const std::vector<std::string>& inputs,
+                                           const std::string& session_id = std::string());
     std::string generate_response(const std::string& prompt, int max_tokens = 100);
+    std::string generate_response(const std::string& prompt, const GenerationOptions& options);
+    
+    // Iteration-level decoding used by DecodeScheduler: begin_generation()
+    // returns the response prefix for a prompt, end_generation() records
+    // the finished exchange in its session, and decode_step() advances
+    // every context in the batch with a single forward pass, choosing each
+    // context's tokens with its own sampler. Without speculative decoding
+    // every context gets exactly one token; with it, one to
+    // speculative_tokens + 1. A context's tokens stop after an end of sequence.
+    std::string begin_generation(const std::string& prompt);
+    void end_generation(const std::string& prompt, const std::string& response, const std::string& session_id);
+    std::vector<std::vector<DecodedToken>> decode_step(const std::vector<std::string>& contexts,
+                                                       const std::vector<Sampler*>& samplers);
+    
+    // Sampler for one request, with unset options filled from the config
+    Sampler make_sampler(const GenerationOptions& options) const;
     
     // Training
     void train(const std::vector<std::string>& training_data);
+    
+    // Streaming training: one step per batch of packed token sequences,
+    // taking the model lock per batch so requests are served between
+    // steps. Stops after max_batches (0 = until the loader runs dry) and
+    // returns the number of batches trained.
+    size_t train(DataLoader& loader, size_t max_batches = 0);
+    void train_batch(const TokenBatch& batch);
     void update(const std::string& input, const std::string& expected_output);
     
+    // Checkpointing. Once enabled, every `interval` training steps the
+    // weights are copied into a staging buffer under the model lock and
+    // written to directory by a background thread, which keeps the newest
+    // keep_last files; training never waits for the disk. An interval of
+    // 0 writes only on save_checkpoint().
+    void enable_checkpoints(const std::string& directory, size_t interval, size_t keep_last = 3);
+    bool save_checkpoint();   // Queues a snapshot now; false when checkpointing is off
+    void flush_checkpoints(); // Waits until queued snapshots are on disk
+    bool load_checkpoint(const std::string& path);  // A directory loads its newest checkpoint
+    uint64_t get_training_steps() const;
+    
     // State management
     void initialize();
     void reset();
@@ -30,36 +86,96 @@ public:
     
     // Metrics
     BrainMetrics get_metrics() const;
-    float get_confidence() const;
+    float get_confidence(const std::string& session_id = std::string()) const;
     
     // Configuration
     void update_config(const BrainConfig& config);
     BrainConfig get_config() const;
     
-    // Context management
-    LanguageContext get_context() const;
-    void set_context(const LanguageContext& context);
+    // Sessions. Reading an unknown session yields empty state; writing one
+    // opens it.
+    LanguageContext get_context(const std::string& session_id = std::string()) const;
+    void set_context(const LanguageContext& context, const std::string& session_id = std::string());
+    bool get_session_history(const std::string& session_id, std::vector<DialogueTurn>& history) const;
+    bool close_session(const std::string& session_id);
+    SessionPool::Stats get_session_stats() const { return sessions_.get_stats(); }
     
     // Memory access
-    std::vector<MemoryRecord> recall_memories(const std::string& query);
+    std::vector<MemoryRecord> recall_memories(const std::string& query, int count = 5);
+    std::vector<MemoryRecord> recall_memories_by_category(const std::string& category);
     void store_interaction(const std::string& input, const std::string& output);
     
+    // Tokenizer. The engine starts byte-level (one token per byte) until a
+    // trained BPE vocabulary is loaded; the tokenizer is immutable once
+    // published, so callers may keep using a returned instance
+    bool load_tokenizer(const std::string& path);
+    std::shared_ptr<const BpeTokenizer> get_tokenizer() const;
+    
+    // Change counters for response caching. The model version moves whenever
+    // the weights, tokenizer or configuration change, the memory version
+    // whenever the stored memories do. Reading one takes no lock.
+    uint64_t get_model_version() const { return model_version_.load(std::memory_order_acquire); }
+    uint64_t get_memory_version() const { return memory_version_.load(std::memory_order_acquire); }
+    
+    PrefixCache::Stats get_prefix_cache_stats() const { return prefix_cache_.get_stats(); }
+    
 private:
+    mutable std::shared_mutex mutex_;
+    mutable std::mutex memory_mutex_;   // MemorySystem is not thread-safe; taken after mutex_
+    mutable std::mutex metrics_mutex_;  // Guards the get_metrics() sample
+    
     BrainConfig config_;
-    BrainState state_;
+    std::atomic<BrainState> state_;
+    std::atomic<int> active_requests_;  // Inference calls in flight; reported as Processing
     
     std::unique_ptr<NeuralNetwork> neural_net_;
+    std::unique_ptr<NeuralNetwork> draft_net_;  // Null unless speculative decoding is on
     std::unique_ptr<MemorySystem> memory_;
     std::unique_ptr<AttentionMechanism> attention_;
+    std::shared_ptr<const BpeTokenizer> tokenizer_;
     
-    LanguageContext context_;
     BrainMetrics metrics_;
-    float confidence_;
+    SessionPool sessions_;
+    
+    // Previous get_metrics() sample; CPU and throughput are rates since then
+    mutable ProcessStats metrics_sample_;
+    mutable uint64_t sampled_tokens_generated_;
+    
+    std::atomic<uint64_t> model_version_;
+    std::atomic<uint64_t> memory_version_;
+    
+    // Token ids and response preambles of recent prompts. Only the
+    // tokenizer determines cached ids, so loading one clears the cache.
+    PrefixCache prefix_cache_;
+    
+    // Background checkpoint writer; null until enable_checkpoints()
+    std::unique_ptr<CheckpointWriter> checkpoints_;
+    size_t checkpoint_interval_;
+    uint64_t training_steps_;  // Optimizer steps taken; written under the exclusive lock
+    
+    // A prompt that shares at least this many bytes with a cached key gets
+    // an entry for the shared part, so a common preamble is cached on its own
+    static constexpr size_t kMinSharedPrefix = 32;
     
-    // Helper methods
-    std::vector<float> tokenize(const std::string& text);
+    // Helper methods (callers must hold mutex_, shared or exclusive)
+    void store_interaction_locked(const std::string& input, const std::string& output, float importance);
+    void store_interactions_locked(const std::vector<std::string>& inputs,
+                                   const std::vector<std::string>& outputs, float importance);
+    void finish_training_step_locked();
+    void snapshot_locked();
+    void record_weight_bytes_locked();
+    std::string begin_generation_locked(const std::string& prompt);
+    std::vector<std::vector<DecodedToken>> decode_step_locked(const std::vector<std::string>& contexts,
+                                                              const std::vector<Sampler*>& samplers);
+    std::vector<std::vector<DecodedToken>> speculative_step_locked(const std::vector<std::string>& contexts,
+                                                                   const std::vector<Sampler*>& samplers);
+    SamplingParams sampling_params_locked(const GenerationOptions& options) const;
+    std::vector<int> token_ids(std::string_view text, size_t limit);
+    void cache_prefix_tokens(const std::string& text);
+    std::vector<float> tokenize(const std::string& text, size_t limit);
     std::string detokenize(const std::vector<float>& tokens);
     Activation encode_input(const std::string& input);
+    Activation encode_tokens(const int* ids, size_t count) const;
     std::string decode_output(const Activation& output);
 };
 
@@ -3,6 +3,8 @@
 #include "brain_types.h"
 #include <queue>
 #include <deque>
+#include <set>
+#include <unordered_map>
 
 namespace BrainLLM {
 
@@ -13,6 +15,8 @@ public:
     
     // Memory operations
     void store_memory(const std::string& content, float importance = 1.0f);
+    // Stores a batch with one timestamp; the strings are moved into storage
+    void store_memories(std::vector<std::string> contents, float importance = 1.0f);
     std::vector<MemoryRecord> retrieve_memories(const std::string& query, int count = 5);
     void clear_memories();
     
@@ -26,15 +30,36 @@ public:
     void categorize_memory(const std::string& content, const std::string& category);
     std::vector<MemoryRecord> get_memories_by_category(const std::string& category);
     
+    // Lightweight views into storage, valid until the next mutating call
+    std::vector<const MemoryRecord*> view_memories_by_category(const std::string& category) const;
+    size_t get_category_count(const std::string& category) const;
+    
 private:
     struct MemoryEntry {
+        uint64_t id;
         MemoryRecord record;
         uint64_t last_accessed;
     };
     
+    // Ids are assigned sequentially and entries are only appended or popped
+    // from the front, so an id maps to its deque slot by subtracting the id
+    // of the front entry.
     std::deque<MemoryEntry> memory_storage_;
+    uint64_t next_id_;
     int max_size_;
     
+    // Secondary indexes: category -> ids (in insertion order), content hash -> ids
+    std::unordered_map<std::string, std::set<uint64_t>> category_index_;
+    std::unordered_multimap<size_t, uint64_t> content_index_;
+    
+    MemoryEntry* find_entry(uint64_t id);
+    const MemoryEntry* find_entry(uint64_t id) const;
+    void index_entry(const MemoryEntry& entry);
+    void unindex_entry(const MemoryEntry& entry);
+    
+    void append_entry(std::string content, float importance, uint64_t timestamp);
+    static uint64_t current_timestamp();
+    
     float calculate_relevance(const std::string& memory, const std::string& query) const;
     void remove_oldest();
 };
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace BrainLLM {
+
+// Hot-path instrumentation. Every recording operation is a single relaxed
+// atomic add on a cache-line-aligned slot owned by the calling thread's
+// shard, so threads never contend on a shared counter. Reads merge the
+// shards and are meant for scrapes, not for the hot path.
+
+constexpr size_t kMetricShards = 16;
+
+// Shard index of the calling thread, assigned round-robin on first use
+size_t metric_shard();
+
+class Counter {
+public:
+    void add(uint64_t amount = 1) {
+        slots_[metric_shard()].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value{0};
+    };
+    Slot slots_[kMetricShards];
+};
+
+class Gauge {
+public:
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void add(int64_t amount) { value_.fetch_add(amount, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+struct HistogramSnapshot {
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    
+    // Value at quantile q in [0, 1], accurate to the bucket resolution
+    uint64_t percentile(double q) const;
+    // Number of samples whose bucket lies entirely at or below `value`
+    uint64_t count_at_or_below(uint64_t value) const;
+};
+
+// HDR-style log-linear histogram of non-negative integers (nanoseconds for
+// latencies). Each power of two is split into 16 linear sub-buckets, giving
+// at most 6.25% relative error from 1ns up to about nine minutes. The layout
+// is fixed: kSubBuckets exact slots for values below kSubBuckets, then
+// kSubBuckets slots for each exponent from kSubBucketBits to kMaxExponent,
+// which is where kBucketCount comes from. Recording never allocates.
+class Histogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr uint64_t kSubBuckets = 1ULL << kSubBucketBits;
+    static constexpr int kMaxExponent = 39;
+    static constexpr size_t kBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+    
+    void record(uint64_t value);
+    HistogramSnapshot snapshot() const;
+    
+    static size_t bucket_index(uint64_t value);
+    static uint64_t bucket_lower_bound(size_t index);
+    static uint64_t bucket_upper_bound(size_t index);  // Exclusive
+
+private:
+    static constexpr size_t kShards = 8;
+    
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> buckets[kBucketCount] = {};
+        std::atomic<uint64_t> sum{0};
+    };
+    Shard shards_[kShards];
+};
+
+// Records the lifetime of a scope into a histogram, in nanoseconds
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram);
+    ~ScopedTimer();
+    
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram_;
+    uint64_t start_;
+};
+
+uint64_t monotonic_nanoseconds();
+
+// Process-wide resource usage, read on demand from the OS and allocator
+struct ProcessStats {
+    double cpu_seconds = 0.0;
+    uint64_t resident_bytes = 0;
+    uint64_t allocated_bytes = 0;   // Bytes in use by malloc, where the allocator reports it
+    double uptime_seconds = 0.0;
+};
+
+ProcessStats read_process_stats();
+
+// Named metrics exported in Prometheus text format. Metrics are registered
+// once and live as long as the registry, so hot paths can hold references.
+class MetricsRegistry {
+public:
+    Counter& add_counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& add_gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& add_histogram(const std::string& name, const std::string& help);
+    
+    // Appends every metric plus process statistics in text format 0.0.4
+    void write_prometheus(std::string& out) const;
+
+private:
+    enum class Kind {
+        Counter,
+        Gauge,
+        Histogram
+    };
+    
+    struct Entry {
+        Kind kind;
+        std::string name;
+        std::string help;
+        std::string labels;
+        size_t index;
+    };
+    
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+    std::deque<Counter> counters_;     // deque keeps references stable
+    std::deque<Gauge> gauges_;
+    std::deque<Histogram> histograms_;
+};
+
+// Well-known metrics recorded by the engine, scheduler and API layer
+struct RuntimeMetrics {
+    MetricsRegistry registry;
+    
+    Counter& requests_ok;
+    Counter& requests_client_error;
+    Counter& requests_server_error;
+    Histogram& request_duration;
+    
+    Counter& requests_unauthorized;
+    Counter& requests_rate_limited;
+    Counter& requests_shed;
+    Counter& connections_rejected;
+    Gauge& request_queue_depth;
+    
+    Counter& forward_passes;
+    Counter& forward_inputs;
+    Histogram& forward_duration;
+    
+    Counter& tokens_processed;
+    Counter& tokens_generated;
+    Counter& speculative_accepted;
+    Counter& speculative_rejected;
+    
+    Counter& memory_retrievals;
+    Histogram& memory_retrieval_duration;
+    
+    Gauge& decode_queue_depth;
+    Gauge& decode_active_sequences;
+    
+    Counter& response_cache_hits;
+    Counter& response_cache_misses;
+    Counter& response_cache_evictions;
+    Gauge& response_cache_entries;
+    
+    Counter& prefix_cache_hits;
+    Counter& prefix_cache_misses;
+    Gauge& prefix_cache_bytes;
+    
+    Counter& sessions_allocated;
+    Counter& sessions_recycled;
+    Counter& sessions_evicted;
+    Gauge& sessions_active;
+    
+    Counter& checkpoints_written;
+    Counter& checkpoints_superseded;
+    Counter& checkpoints_failed;
+    Histogram& checkpoint_write_duration;
+    
+    Gauge& training_activation_bytes;
+    Gauge& model_weight_bytes;
+    
+    RuntimeMetrics();
+};
+
+RuntimeMetrics& runtime_metrics();
+
+} // namespace BrainLLM
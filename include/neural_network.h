@@ -1,10 +1,48 @@
 #pragma once
 
 #include "brain_types.h"
+#include "checkpoint.h"
 #include <random>
 
 namespace BrainLLM {
 
+// One layer's weights, [rows x cols] row-major in a single aligned block
+// with rows padded to whole cache lines. fp16/bf16 storage halves the
+// bytes every forward pass streams; rows are widened to fp32 on read, so
+// all arithmetic and accumulation stays in fp32.
+class WeightMatrix {
+public:
+    WeightMatrix(size_t rows, size_t cols, StoragePrecision precision);
+    
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    StoragePrecision precision() const { return precision_; }
+    size_t memory_bytes() const;
+    
+    // Row j in fp32: a pointer into the matrix for fp32 storage, otherwise
+    // buffer (at least cols floats) holding the widened row
+    const float* row(size_t j, float* buffer) const;
+    void set_row(size_t j, const float* values);
+    
+    // Dot product of the first width elements of row j with x, without
+    // widening the row into memory first
+    float dot(size_t j, const float* x, size_t width) const;
+    
+    // row j -= scale * gradient; half-precision rows are updated in fp32
+    // and rounded once, so steps below half a unit in the last place of
+    // the stored weight are lost
+    void subtract_scaled(size_t j, const float* gradient, float scale, float* buffer);
+    void fill_zero();
+    
+private:
+    size_t rows_;
+    size_t cols_;
+    size_t stride_;                    // Elements per row, padded to whole cache lines
+    StoragePrecision precision_;
+    AlignedVector<float> full_;        // fp32 storage
+    AlignedVector<uint16_t> half_;     // Same layout for fp16/bf16 storage
+};
+
 class NeuralNetwork {
 public:
     NeuralNetwork(const BrainConfig& config);
@@ -13,8 +51,26 @@ public:
     // Forward propagation
     Activation forward(const Activation& input);
     
-    // Backward propagation
-    void backward(const Activation& gradient);
+    // Batched forward: each weight row is loaded once and applied to every
+    // input in the batch before moving on, so weight traffic is amortized
+    std::vector<Activation> forward_batch(const std::vector<Activation>& inputs);
+    
+    // Training. forward_training() runs a batch like forward_batch() but
+    // keeps the layer inputs backward() needs; backward() then computes the
+    // gradients of the mean squared error against targets for
+    // update_weights(). Only the input of every checkpoint_interval-th
+    // layer is kept: backward() recomputes the rest one segment at a time
+    // from the nearest kept input, so held activations grow with
+    // layers / interval + interval instead of layers, for at most one extra
+    // forward pass. An interval of 1 keeps everything and recomputes
+    // nothing; 0 picks about sqrt(layers), which minimizes memory.
+    std::vector<Activation> forward_training(const std::vector<Activation>& inputs);
+    Activation forward_training(const Activation& input);
+    void backward(const std::vector<Activation>& targets);
+    void backward(const Activation& target);
+    void set_checkpoint_interval(int interval);
+    size_t get_checkpoint_interval() const { return checkpoint_interval_; }
+    size_t get_activation_bytes() const;  // Activation memory held for training
     
     // Layer management
     void add_layer(int size);
@@ -28,17 +84,47 @@ public:
     // Gradient descent
     void update_weights(float learning_rate);
     
+    // Records the loss of a training step for get_metrics(); a batch
+    // records its mean loss
+    void record_loss(const Activation& predicted, const Activation& expected);
+    void record_loss(const std::vector<Activation>& predicted, const std::vector<Activation>& expected);
+    
+    // Checkpointing. save_weights() copies every layer into tensors named
+    // prefix.layerN starting at tensors[next], reusing their storage;
+    // load_weights() fails unless the checkpoint matches this shape.
+    void save_weights(const std::string& prefix, std::vector<CheckpointTensor>& tensors, size_t& next) const;
+    bool load_weights(const std::string& prefix, const Checkpoint& checkpoint);
+    
+    // Weight storage. Switching precision converts the current weights in
+    // place; checkpoints always hold fp32, so they load at any precision.
+    void set_precision(StoragePrecision precision);
+    StoragePrecision get_precision() const { return config_.weight_precision; }
+    size_t get_weight_bytes() const;
+    
     // State management
     BrainMetrics get_metrics() const;
     void reset();
     
 private:
     BrainConfig config_;
-    std::vector<NeuralLayer> layers_;
+    std::vector<WeightMatrix> layers_;
     std::vector<NeuralLayer> gradients_;
     std::mt19937 rng_;
+    float last_loss_;  // Negative until a training step has been recorded
+    
+    // Training activations. saved_[i] holds the batch's input to layer i
+    // when i is a multiple of the interval, and saved_[layers] the outputs;
+    // other entries stay empty. Buffers are reused across steps.
+    size_t checkpoint_interval_;
+    std::vector<std::vector<Activation>> saved_;
+    std::vector<std::vector<Activation>> segment_;   // Inputs recomputed within one segment
+    std::vector<Activation> scratch_[2];             // Outputs not kept by forward_training()
+    std::vector<Activation> grad_;                   // Loss gradient w.r.t. the current layer's output
+    std::vector<Activation> grad_input_;             // ... and w.r.t. its input
     
     float compute_loss(const Activation& predicted, const Activation& expected);
+    void apply_layer(size_t layer, const std::vector<Activation>& inputs, std::vector<Activation>& outputs) const;
+    void backward_layer(size_t layer, const std::vector<Activation>& inputs, const std::vector<Activation>& outputs);
 };
 
 } // namespace BrainLLM
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BrainLLM {
+
+// Work computed for prompt prefixes, shared across requests. Keys are the
+// prompt bytes, stored in a radix tree so every request finds the longest
+// cached prefix of its text in one walk, and requests that open with the
+// same long preamble share one path.
+//
+// A node may carry two things:
+//   - token ids for a prefix of its key. Callers extend keys a few bytes
+//     past a tokenizer boundary, so any text that starts with the key has
+//     that boundary too and the ids stay correct whatever follows
+//   - the response preamble generated for exactly that prompt, tagged with
+//     the memory version it was retrieved against
+//
+// Nodes carrying data form an LRU list; when the tree grows past its byte
+// budget the least recently used data is dropped and emptied nodes are
+// pruned or merged back into their neighbours.
+class PrefixCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;        // Lookups that reused cached work
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;       // Nodes carrying data
+        size_t bytes = 0;         // Estimated footprint of the tree
+    };
+    
+    explicit PrefixCache(size_t max_bytes = 32 * 1024 * 1024);
+    
+    PrefixCache(const PrefixCache&) = delete;
+    PrefixCache& operator=(const PrefixCache&) = delete;
+    
+    // Finds the longest cached key that text starts with, appends its ids
+    // to tokens and returns how many bytes of text they cover (0 on a miss)
+    size_t match_tokens(std::string_view text, std::vector<int>& tokens);
+    
+    // Stores the ids of key[0, covered) (covered < key.size()). Returns how
+    // many leading bytes of key the tree already held, i.e. where it
+    // branches from earlier keys.
+    size_t insert_tokens(std::string_view key, size_t covered, std::vector<int> tokens);
+    
+    bool lookup_preamble(std::string_view prompt, uint64_t memory_version, std::string& out);
+    void insert_preamble(std::string_view prompt, uint64_t memory_version, std::string preamble);
+    
+    void clear();
+    Stats get_stats() const;
+
+private:
+    struct Node {
+        std::string edge;   // Bytes on the edge from the parent
+        Node* parent = nullptr;
+        std::map<char, std::unique_ptr<Node>> children;
+        
+        bool has_tokens = false;
+        size_t covered = 0;   // Key bytes the tokens encode
+        std::vector<int> tokens;
+        bool has_preamble = false;
+        uint64_t memory_version = 0;
+        std::string preamble;
+        
+        bool in_lru = false;
+        std::list<Node*>::iterator lru;
+    };
+    
+    mutable std::mutex mutex_;
+    size_t max_bytes_;
+    size_t bytes_;
+    Node root_;
+    std::list<Node*> lru_;  // Nodes carrying data, most recently used first
+    Stats stats_;
+    
+    // Node whose path spells exactly key, or null
+    Node* find_exact(std::string_view key);
+    Node* insert_node(std::string_view key, size_t& shared);
+    void touch(Node* node);
+    void drop_data(Node* node);
+    void prune(Node* node);
+    void evict_to_budget(const Node* keep);
+    
+    static size_t node_bytes(const Node& node);
+};
+
+} // namespace BrainLLM
@@ -1,31 +1,128 @@
 #pragma once
 
-#include "rest_server.h"
-#include <QString>
+#include "llm_engine.h"
+#include "decode_scheduler.h"
+#include "metrics.h"
+#include "response_cache.h"
+#include "http_parser.h"
+#include "json_writer.h"
+#include "json_reader.h"
+#include <string>
+#include <string_view>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace BrainLLM {
 
+struct ApiResponse {
+    int status_code;
+    std::string body;
+    const char* content_type = "application/json";
+};
+
+// View of an incoming request handed to endpoint handlers. Method, path,
+// query and parameters point into the HttpRequest being served, and the
+// body is referenced rather than copied.
+struct ApiRequest {
+    static constexpr size_t kMaxParams = 4;
+    
+    std::string_view method;
+    std::string_view path;
+    std::string_view query;
+    const std::string& body;
+    std::string_view content_type;
+    std::string_view session_id;  // X-Session-Id header; empty when absent
+    std::string_view params[kMaxParams];
+    size_t param_count = 0;
+    
+    std::string query_param(std::string_view name) const;
+};
+
+// Qt-free so it can back both RestServer and the native EpollServer.
+// Dispatch goes through a route table built once at construction: exact
+// paths are found by hashing method and path, while patterns such as
+// "/api/memory/category/{category}" are matched segment by segment.
+// Generation requests go through a DecodeScheduler so concurrent callers
+// share batched decode steps instead of taking turns on the engine.
+// Responses of the deterministic /api/process and /api/memory endpoints are
+// served from a ResponseCache until the engine's version moves; a cached
+// /api/process reply is not stored as a new memory.
+// Requests name their session with an X-Session-Id header or a "session_id"
+// body field; each session keeps its own context and dialogue history in
+// the engine, and requests without one share the default session.
 class RequestHandler {
 public:
     RequestHandler(std::shared_ptr<LLMEngine> engine);
     ~RequestHandler() = default;
     
-    QString handle_request(const QString& method, const QString& path, const QString& body);
+    // The response body is serialized into `buffer`, whose storage is moved
+    // into the returned ApiResponse; pass back a spent body to reuse its capacity
+    ApiResponse handle_request(const HttpRequest& request, std::string buffer = std::string());
     
 private:
+    // Handlers write their JSON body and return the HTTP status code
+    using RouteHandler = int (RequestHandler::*)(const ApiRequest&, JsonWriter&);
+    
+    // Bodies are either plain text (the original API) or a JSON object
+    // with named fields, e.g. {"prompt": "...", "max_tokens": 64}
+    enum class BodyFormat {
+        Text,
+        Json,
+        Invalid
+    };
+    
+    static constexpr int kMaxGenerationTokens = 4096;
+    static constexpr int kMaxMemoryResults = 1000;
+    static constexpr size_t kMaxBatchInputs = 256;
+    static constexpr size_t kResponseCacheEntries = 4096;
+    static constexpr size_t kMaxSessionIdLength = 128;
+    
+    struct Route {
+        std::string method;
+        std::string pattern;
+        std::vector<std::string> segments;
+        RouteHandler handler;
+        const char* content_type;
+    };
+    
     std::shared_ptr<LLMEngine> engine_;
+    std::unique_ptr<DecodeScheduler> scheduler_;
+    ResponseCache response_cache_;
+    
+    // Route table
+    std::vector<Route> routes_;
+    std::unordered_map<uint64_t, size_t> exact_routes_;   // hash(method, path) -> routes_ index
+    std::vector<size_t> pattern_routes_;
+    
+    void add_route(const std::string& method, const std::string& pattern, RouteHandler handler,
+                   const char* content_type = "application/json");
+    const Route* find_route(std::string_view method, std::string_view path, ApiRequest& request,
+                            bool& path_matched) const;
+    static bool match_pattern(const Route& route, std::string_view path, ApiRequest& request);
+    static uint64_t route_hash(std::string_view method, std::string_view path);
+    static BodyFormat parse_body(const ApiRequest& request, JsonReader& reader);
     
     // Endpoint handlers
-    QString handle_process(const QString& body);
-    QString handle_generate(const QString& body);
-    QString handle_status(const QString& body);
-    QString handle_memory(const QString& body);
-    QString handle_config(const QString& body);
-    QString handle_train(const QString& body);
+    int handle_process(const ApiRequest& request, JsonWriter& json);
+    int handle_process_batch(const ApiRequest& request, JsonWriter& json);
+    int handle_generate(const ApiRequest& request, JsonWriter& json);
+    int handle_status(const ApiRequest& request, JsonWriter& json);
+    int handle_memory(const ApiRequest& request, JsonWriter& json);
+    int handle_memory_category(const ApiRequest& request, JsonWriter& json);
+    int handle_config(const ApiRequest& request, JsonWriter& json);
+    int handle_session(const ApiRequest& request, JsonWriter& json);
+    int handle_session_close(const ApiRequest& request, JsonWriter& json);
+    int handle_train(const ApiRequest& request, JsonWriter& json);
+    int handle_metrics(const ApiRequest& request, JsonWriter& json);
+    int handle_trace_dump(const ApiRequest& request, JsonWriter& json);
+    int handle_trace_control(const ApiRequest& request, JsonWriter& json);
     
     // Helper methods
-    QString create_json_response(const std::string& message);
-    QString create_error_response(const std::string& error);
+    static bool read_session_id(const ApiRequest& request, JsonValue body, std::string& session_id);
+    static int write_message(JsonWriter& json, std::string_view message);
+    static int write_error(JsonWriter& json, std::string_view error, int status_code = 400);
+    static int write_memories(JsonWriter& json, const std::vector<MemoryRecord>& memories);
 };
 
 } // namespace BrainLLM
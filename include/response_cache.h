@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace BrainLLM {
+
+// Serialized responses for deterministic endpoints, keyed by endpoint,
+// normalized input and the engine version the response was computed
+// against. A version bump (train, update, reset) makes every older entry
+// unreachable without having to find it; such entries are the first to be
+// evicted.
+//
+// The cache is split into independently locked shards, each an LRU list
+// guarded by a TinyLFU admission filter: when a shard is full, a new entry
+// only displaces the LRU victim if it has been requested more often, so a
+// burst of one-off inputs cannot flush the frequently repeated ones.
+class ResponseCache {
+public:
+    enum class Endpoint : uint8_t {
+        Process,
+        Memory
+    };
+    
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t rejections = 0;  // Inserts refused by the admission filter
+        size_t entries = 0;
+    };
+    
+    static constexpr size_t kShards = 16;
+    static constexpr size_t kMaxBodyBytes = 64 * 1024;
+    
+    explicit ResponseCache(size_t max_entries = 4096);
+    
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+    
+    // Appends the cached body to `out` and returns true on a hit
+    bool lookup(Endpoint endpoint, std::string_view key, uint64_t version, std::string& out);
+    void insert(Endpoint endpoint, std::string_view key, uint64_t version, std::string_view body);
+    void clear();
+    
+    Stats get_stats() const;
+
+private:
+    // Count-min sketch of recent request frequency with 4-bit saturating
+    // counters. All counters are halved once the sample reaches ten times
+    // the shard capacity, so old popularity fades.
+    class FrequencySketch {
+    public:
+        explicit FrequencySketch(size_t capacity);
+        
+        void increment(uint64_t hash);
+        uint8_t estimate(uint64_t hash) const;
+        void clear();
+
+    private:
+        static constexpr int kDepth = 4;
+        
+        std::vector<uint8_t> counters_;
+        size_t mask_;
+        size_t additions_;
+        size_t sample_size_;
+        
+        size_t slot(uint64_t hash, int row) const;
+    };
+    
+    struct Entry {
+        uint64_t hash;
+        Endpoint endpoint;
+        uint64_t version;
+        std::string key;
+        std::string body;
+    };
+    
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;  // Most recently used first
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+        FrequencySketch sketch;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t rejections = 0;
+        
+        explicit Shard(size_t capacity) : sketch(capacity) {}
+    };
+    
+    size_t shard_capacity_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    
+    static uint64_t hash_key(Endpoint endpoint, std::string_view key, uint64_t version);
+    void evict_back(Shard& shard);
+};
+
+} // namespace BrainLLM
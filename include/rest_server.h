@@ -1,13 +1,26 @@
 #pragma once
 
 #include <QString>
+#include <QByteArray>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QThreadPool>
 #include <memory>
+#include <map>
+#include <unordered_map>
 #include "llm_engine.h"
+#include "http_parser.h"
+#include "request_handler.h"
+#include "admission_control.h"
+#include "config_manager.h"
 
 namespace BrainLLM {
 
+// Sockets are owned by the Qt event-loop thread; request handling runs on a
+// bounded worker pool and completed responses are posted back to the event
+// loop, which writes them out in request order. Every connection and parsed
+// request first passes the AdmissionController, which enforces the API key,
+// connection cap, per-client rate limit and queue deadline from APISettings.
 class RestServer : public QObject {
     Q_OBJECT
 
@@ -20,26 +33,61 @@ public:
     bool is_running() const;
     
     void set_llm_engine(std::shared_ptr<LLMEngine> engine);
+    void set_api_settings(const ConfigManager::APISettings& settings);
     
 private slots:
     void on_new_connection();
     void on_read_ready();
+    void on_bytes_written();
     void on_disconnected();
     
 private:
+    struct PendingResponse {
+        QByteArray data;
+        bool close_after;
+    };
+    
+    // Per-connection framing state; requests on a keep-alive connection are
+    // answered in the order they were received
+    struct Connection {
+        uint64_t id = 0;
+        HttpParser parser;
+        bool closing = false;          // No further requests will be read
+        uint64_t next_sequence = 0;    // Assigned to the next parsed request
+        uint64_t next_to_write = 0;    // Sequence of the next response to send
+        std::map<uint64_t, PendingResponse> completed;
+    };
+    
+    // Requests in flight per connection before reading pauses
+    static constexpr uint64_t kMaxPipelinedRequests = 16;
+    // Bytes Qt buffers per socket; once full it stops reading, so a paused
+    // connection pushes back on the peer through TCP instead of growing memory
+    static constexpr qint64 kReadBufferBytes = 64 * 1024;
+    // Unsent response bytes at which reading pauses, for peers that never read
+    static constexpr qint64 kWriteBacklogBytes = 256 * 1024;
+    
     QTcpServer* tcp_server_;
+    QThreadPool* worker_pool_;
     int port_;
     std::shared_ptr<LLMEngine> engine_;
+    std::shared_ptr<RequestHandler> handler_;
+    AdmissionController admission_;
     
-    struct HttpRequest {
-        QString method;
-        QString path;
-        QString body;
-        std::map<QString, QString> headers;
-    };
+    std::unordered_map<QTcpSocket*, Connection> connections_;
+    std::unordered_map<uint64_t, QTcpSocket*> connection_sockets_;
+    uint64_t next_connection_id_;
+    
+    void read_requests(QTcpSocket* socket, Connection& connection);
+    bool process_requests(QTcpSocket* socket, Connection& connection);
+    void dispatch(uint64_t connection_id, uint64_t sequence, HttpRequest request);
+    void on_response_ready(uint64_t connection_id, uint64_t sequence, const PendingResponse& response);
+    bool flush_responses(QTcpSocket* socket, Connection& connection);
     
-    HttpRequest parse_http_request(const QString& raw_request);
-    QString build_http_response(const QString& body, int status_code = 200);
+    static PendingResponse rejection(AdmissionController::Decision decision, int retry_after_seconds,
+                                     bool keep_alive);
+    static QByteArray build_http_response(const std::string& body, int status_code = 200, bool keep_alive = true,
+                                          const char* content_type = "application/json",
+                                          int retry_after_seconds = 0);
 };
 
 } // namespace BrainLLM
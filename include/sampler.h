@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace BrainLLM {
+
+// Fully resolved sampling parameters for one request
+struct SamplingParams {
+    float temperature = 1.0f;         // 0 always picks the most likely token
+    int top_k = 0;                    // Sample among the k most likely tokens; 0 disables
+    float top_p = 1.0f;               // Sample from the smallest set holding this much probability
+    float repetition_penalty = 1.0f;  // Above 1 discourages tokens this request already produced
+    uint64_t seed = 0;
+};
+
+// Picks tokens from a logit vector for one request. The sampler owns the
+// request's RNG and token history, and keeps its working buffers between
+// calls so decoding a token allocates nothing once the first token is done.
+//
+// Per token: the repetition penalty is applied to the logits of tokens
+// already generated, logits are divided by the temperature, the top_k
+// candidates are found by partial selection, and nucleus (top_p) filtering
+// sorts only as long a prefix of the candidates as it needs, growing it
+// from a small batch. Not thread-safe; use one sampler per sequence.
+//
+// Speculative decoding needs the distribution itself rather than a draw:
+// distribution() returns it, sample_from() draws from any distribution, and
+// rewind() drops tokens that were only proposed from the history.
+class Sampler {
+public:
+    explicit Sampler(const SamplingParams& params = SamplingParams());
+    
+    // Returns the chosen index into logits and records it in the history
+    int sample(const float* logits, size_t count);
+    int sample(const std::vector<float>& logits) { return sample(logits.data(), logits.size()); }
+    
+    // Probabilities sample() would draw from given the current history:
+    // zero outside the top_k/top_p set, summing to 1. Records nothing.
+    void distribution(const float* logits, size_t count, std::vector<float>& out);
+    
+    // Draws an index from non-negative weights, which need not sum to 1
+    int sample_from(const std::vector<float>& weights);
+    float uniform();
+    
+    // History management for tokens chosen outside sample()
+    void accept(int token) { remember(token); }
+    size_t history_length() const { return history_.size(); }
+    void rewind(size_t length);
+    
+    const SamplingParams& get_params() const { return params_; }
+    const std::vector<int>& get_history() const { return history_; }
+
+private:
+    static constexpr size_t kNucleusBatch = 64;
+    
+    SamplingParams params_;
+    std::mt19937_64 rng_;
+    
+    std::vector<float> scores_;       // Working copy of the logits, then probabilities
+    std::vector<int> candidates_;     // Token ids still eligible
+    std::vector<int> history_;        // Every token sampled so far
+    std::vector<int> distinct_;       // Tokens in history_, each once
+    std::vector<size_t> first_seen_;  // History position where distinct_[i] first appeared
+    std::vector<uint8_t> seen_;       // Token id -> present in distinct_
+    
+    // Leaves the probability mass of candidates_[0, kept) in scores_ and
+    // returns kept; total is their (unnormalized) sum
+    size_t prepare(const float* logits, size_t count, float& total);
+    void apply_repetition_penalty(size_t count);
+    int argmax(size_t count) const;
+    size_t select_top_k(size_t count);
+    size_t select_nucleus(size_t candidates, float total);
+    void remember(int token);
+};
+
+} // namespace BrainLLM
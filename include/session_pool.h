@@ -0,0 +1,105 @@
+#pragma once
+
+#include "brain_types.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace BrainLLM {
+
+struct DialogueTurn {
+    std::string input;
+    std::string output;
+};
+
+// Everything a request changes about a conversation. The model weights are
+// shared by every session; only this state is per session.
+struct SessionState {
+    static constexpr size_t kMaxTurns = 16;
+    
+    std::string id;
+    LanguageContext context{};
+    float confidence = 0.0f;
+    uint64_t turn_count = 0;  // Turns recorded over the session's lifetime
+    std::chrono::steady_clock::time_point last_used;
+    
+    // Ring of the most recent turns; slots keep their string capacity when
+    // overwritten, so a long conversation stops allocating once it wraps
+    std::vector<DialogueTurn> turns;
+    
+    void add_turn(const std::string& input, const std::string& output);
+    std::vector<DialogueTurn> history() const;  // Oldest first
+    
+    // Empties the state for another session, keeping buffer capacity
+    void reset();
+};
+
+// Per-session engine state, addressed by session id. Sessions are created
+// on first use and closed explicitly, evicted least recently used when the
+// pool is full, or expired after sitting idle. A closed session's state goes
+// on a free list and is handed to the next new session, so steady traffic
+// reuses buffers instead of allocating them per session.
+//
+// All methods are thread-safe. Each holds the pool lock only for the copy
+// in or out of the session, never across model work.
+class SessionPool {
+public:
+    struct Stats {
+        size_t active = 0;        // Live sessions
+        size_t free = 0;          // Recycled states waiting for reuse
+        uint64_t created = 0;
+        uint64_t recycled = 0;    // Sessions that started on a recycled state
+        uint64_t evicted = 0;     // Closed for capacity or idleness
+    };
+    
+    explicit SessionPool(size_t max_sessions = 1024,
+                         std::chrono::seconds idle_timeout = std::chrono::minutes(30),
+                         size_t max_free = 64);
+    
+    SessionPool(const SessionPool&) = delete;
+    SessionPool& operator=(const SessionPool&) = delete;
+    
+    // Records a finished request against the session, creating it if needed
+    void record_turn(const std::string& id, const std::string& input, const std::string& output,
+                     float confidence);
+    void set_context(const std::string& id, const LanguageContext& context);
+    
+    // Readers fill out and return true when the session exists
+    bool get_context(const std::string& id, LanguageContext& out) const;
+    bool get_confidence(const std::string& id, float& out) const;
+    bool get_history(const std::string& id, std::vector<DialogueTurn>& out) const;
+    
+    bool close(const std::string& id);
+    void clear();
+    Stats get_stats() const;
+
+private:
+    mutable std::mutex mutex_;
+    size_t max_sessions_;
+    std::chrono::seconds idle_timeout_;
+    size_t max_free_;
+    
+    struct Entry {
+        std::unique_ptr<SessionState> state;
+        std::list<const std::string*>::iterator lru;
+    };
+    
+    std::unordered_map<std::string, Entry> sessions_;
+    std::list<const std::string*> lru_;  // Session ids, most recently used first
+    std::vector<std::unique_ptr<SessionState>> free_;
+    Stats stats_;
+    
+    // Helpers (callers must hold mutex_)
+    SessionState& open(const std::string& id);
+    const SessionState* find(const std::string& id) const;
+    void expire_idle(std::chrono::steady_clock::time_point now);
+    void recycle(const std::string& id);
+};
+
+} // namespace BrainLLM
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__F16C__) || defined(__AVX2__) || defined(__AVX512BF16__)
+#include <immintrin.h>
+#endif
+
+namespace BrainLLM {
+
+// Element type a weight table is stored in. Half-precision storage halves
+// memory and bandwidth; values are always widened to fp32 before use.
+enum class StoragePrecision : uint8_t {
+    Float32,
+    Float16,    // IEEE 754 binary16
+    BFloat16    // Upper half of an fp32: same range, 8-bit mantissa
+};
+
+inline size_t storage_bytes(StoragePrecision precision) {
+    return precision == StoragePrecision::Float32 ? 4 : 2;
+}
+
+inline const char* storage_name(StoragePrecision precision) {
+    switch (precision) {
+        case StoragePrecision::Float16: return "fp16";
+        case StoragePrecision::BFloat16: return "bf16";
+        default: return "fp32";
+    }
+}
+
+// Accepts the names storage_name() produces
+inline bool parse_storage_precision(const std::string& name, StoragePrecision& precision) {
+    if (name == "fp32") {
+        precision = StoragePrecision::Float32;
+    } else if (name == "fp16") {
+        precision = StoragePrecision::Float16;
+    } else if (name == "bf16") {
+        precision = StoragePrecision::BFloat16;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Allocator returning cache-line aligned storage, so table rows padded to a
+// multiple of the line size never straddle lines and vector loads stay aligned
+template <typename T, size_t Alignment = 64>
+class AlignedAllocator {
+public:
+    using value_type = T;
+    
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+    
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+    
+    T* allocate(size_t count) {
+        void* memory = ::operator new(count * sizeof(T), std::align_val_t(Alignment));
+        return static_cast<T*>(memory);
+    }
+    
+    void deallocate(T* pointer, size_t) {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+    
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// Read-only view of contiguous floats, valid while the owning table is
+// neither resized nor destroyed
+struct FloatSpan {
+    const float* data = nullptr;
+    size_t size = 0;
+    
+    const float* begin() const { return data; }
+    const float* end() const { return data + size; }
+    float operator[](size_t i) const { return data[i]; }
+    bool empty() const { return size == 0; }
+    std::vector<float> to_vector() const { return std::vector<float>(begin(), end()); }
+};
+
+inline uint32_t float_bits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float bits_float(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Round to nearest even; NaNs stay NaN
+inline uint16_t float_to_bf16(float value) {
+    uint32_t bits = float_bits(value);
+    if ((bits & 0x7fffffffu) > 0x7f800000u) {
+        return static_cast<uint16_t>((bits >> 16) | 0x40u);
+    }
+    bits += 0x7fffu + ((bits >> 16) & 1u);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float bf16_to_float(uint16_t value) {
+    return bits_float(static_cast<uint32_t>(value) << 16);
+}
+
+// Round to nearest even; overflow saturates to infinity and values below
+// half the smallest subnormal flush to zero
+inline uint16_t float_to_fp16(float value) {
+    uint32_t bits = float_bits(value);
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t magnitude = bits & 0x7fffffffu;
+    
+    if (magnitude > 0x7f800000u) return static_cast<uint16_t>(sign | 0x7e00u);
+    if (magnitude >= 0x47800000u) return static_cast<uint16_t>(sign | 0x7c00u);
+    
+    if (magnitude < 0x38800000u) {
+        if (magnitude < 0x33000000u) return static_cast<uint16_t>(sign);
+        
+        // Subnormal result: shift the full mantissa into place and round
+        uint32_t exponent = magnitude >> 23;
+        uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+        uint32_t shift = 126 - exponent;
+        uint32_t result = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (result & 1u))) ++result;
+        return static_cast<uint16_t>(sign | result);
+    }
+    
+    // Rebias the exponent from 127 to 15; a mantissa carry rolls into the
+    // exponent, up to infinity for values just below 65536
+    uint32_t rebased = magnitude - 0x38000000u;
+    rebased += 0xfffu + ((rebased >> 13) & 1u);
+    return static_cast<uint16_t>(sign | (rebased >> 13));
+}
+
+inline float fp16_to_float(uint16_t value) {
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    
+    if (exponent == 0x1f) return bits_float(sign | 0x7f800000u | (mantissa << 13));
+    if (exponent == 0) {
+        float subnormal = static_cast<float>(mantissa) * 5.9604644775390625e-8f;  // 2^-24
+        return sign ? -subnormal : subnormal;
+    }
+    return bits_float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+// Bulk conversions between fp32 and a 16-bit storage precision. Vector
+// paths are used when the compiler targets F16C, AVX2 or AVX-512 BF16 and
+// round like the scalar code, except that AVX-512 BF16 flushes denormals
+// to zero.
+inline void widen_to_float(const uint16_t* in, float* out, size_t count, StoragePrecision precision) {
+    size_t i = 0;
+    if (precision == StoragePrecision::BFloat16) {
+#if defined(__AVX2__)
+        // bf16 is the top half of an fp32, so widening is a 16-bit shift
+        for (; i + 8 <= count; i += 8) {
+            __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            __m256i wide = _mm256_slli_epi32(_mm256_cvtepu16_epi32(half), 16);
+            _mm256_storeu_ps(out + i, _mm256_castsi256_ps(wide));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = bf16_to_float(in[i]);
+        }
+        return;
+    }
+
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(half));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = fp16_to_float(in[i]);
+    }
+}
+
+inline void narrow_from_float(const float* in, uint16_t* out, size_t count, StoragePrecision precision) {
+    size_t i = 0;
+    if (precision == StoragePrecision::BFloat16) {
+#if defined(__AVX512BF16__) && defined(__AVX512VL__)
+        for (; i + 8 <= count; i += 8) {
+            __m128bh half = _mm256_cvtneps_pbh(_mm256_loadu_ps(in + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), reinterpret_cast<__m128i&>(half));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = float_to_bf16(in[i]);
+        }
+        return;
+    }
+
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), half);
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = float_to_fp16(in[i]);
+    }
+}
+
+// Dot product of count 16-bit weights with fp32 inputs. Weights are widened
+// in registers and accumulated in fp32 lanes, so a row is read once at half
+// the bytes of an fp32 row; the sum order differs from a sequential loop.
+inline float dot_widened(const uint16_t* weights, const float* x, size_t count, StoragePrecision precision) {
+    size_t i = 0;
+    float sum = 0.0f;
+#if defined(__AVX2__) && defined(__F16C__)
+    auto widen8 = [precision](const uint16_t* in) {
+        __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        if (precision == StoragePrecision::BFloat16) {
+            return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(half), 16));
+        }
+        return _mm256_cvtph_ps(half);
+    };
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= count; i += 16) {
+#if defined(__FMA__)
+        acc0 = _mm256_fmadd_ps(widen8(weights + i), _mm256_loadu_ps(x + i), acc0);
+        acc1 = _mm256_fmadd_ps(widen8(weights + i + 8), _mm256_loadu_ps(x + i + 8), acc1);
+#else
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(widen8(weights + i), _mm256_loadu_ps(x + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(widen8(weights + i + 8), _mm256_loadu_ps(x + i + 8)));
+#endif
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 lanes = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    lanes = _mm_hadd_ps(lanes, lanes);
+    lanes = _mm_hadd_ps(lanes, lanes);
+    sum = _mm_cvtss_f32(lanes);
+#endif
+    for (; i < count; ++i) {
+        float weight = precision == StoragePrecision::BFloat16 ? bf16_to_float(weights[i]) : fp16_to_float(weights[i]);
+        sum += weight * x[i];
+    }
+    return sum;
+}
+
+} // namespace BrainLLM
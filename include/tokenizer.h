@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace BrainLLM {
+
+// Byte-level byte-pair-encoding tokenizer. Ids 0-255 are the raw bytes, so
+// any input encodes losslessly; every learned merge adds one id that stands
+// for the concatenation of two existing tokens.
+//
+// Text is first split into pre-tokens (a word with its leading space, a run
+// of digits, a run of punctuation, or whitespace) and merges never cross a
+// pre-token boundary. Encoding applies merges to each pre-token in rank
+// order, looking pairs up in a hash of merge ranks, which reproduces the
+// segmentation the merges were learned with. Encoding and decoding only
+// read the tokenizer, so one instance may be shared across threads.
+class BpeTokenizer {
+public:
+    static constexpr int kByteTokens = 256;
+    
+    BpeTokenizer();
+    
+    // Learns merges from a corpus until the vocabulary reaches vocab_size
+    // or no pair occurs more than once
+    void train(const std::vector<std::string>& corpus, size_t vocab_size);
+    
+    // Vocabulary files hold a header line followed by one "left right" id
+    // pair per merge, in rank order
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+    
+    std::vector<int> encode(std::string_view text) const;
+    std::vector<std::vector<int>> encode_batch(const std::vector<std::string>& texts) const;
+    std::string decode(const std::vector<int>& tokens) const;
+    
+    size_t vocab_size() const { return kByteTokens + merges_.size(); }
+    size_t merge_count() const { return merges_.size(); }
+    
+    // Splits text into the pieces merges are applied within
+    static std::vector<std::string_view> pre_tokenize(std::string_view text);
+    
+    // Start of the last pre-token of text. The boundary there is fixed by
+    // the bytes before it and the kBoundaryLookahead bytes after it, so every
+    // text sharing those bytes encodes the prefix to the same tokens.
+    static size_t stable_prefix_length(std::string_view text);
+    static constexpr size_t kBoundaryLookahead = 2;
+
+private:
+    struct Merge {
+        int left;
+        int right;
+    };
+    
+    std::vector<Merge> merges_;                          // Rank order; id = kByteTokens + rank
+    std::unordered_map<uint64_t, int> merge_ranks_;      // pair_key(left, right) -> rank
+    std::vector<std::string> token_bytes_;               // Id -> bytes it decodes to
+    
+    void add_merge(int left, int right);
+    void reset();
+    void encode_piece(std::string_view piece, std::vector<int>& out) const;
+    
+    static uint64_t pair_key(int left, int right) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(left)) << 32) | static_cast<uint32_t>(right);
+    }
+};
+
+} // namespace BrainLLM
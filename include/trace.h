@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped tracing. BRAINLLM_TRACE_SCOPE("category", "name") records the
+// enclosing scope as one complete event into the calling thread's ring
+// buffer. When the build does not define BRAINLLM_TRACING the macro expands
+// to nothing; when it does, a disabled tracer costs one relaxed load per
+// scope. Names and categories must be string literals (or otherwise outlive
+// the tracer), since only the pointers are stored.
+#ifdef BRAINLLM_TRACING
+#define BRAINLLM_TRACE_CONCAT_INNER(a, b) a##b
+#define BRAINLLM_TRACE_CONCAT(a, b) BRAINLLM_TRACE_CONCAT_INNER(a, b)
+#define BRAINLLM_TRACE_SCOPE(category, name) \
+    ::BrainLLM::TraceScope BRAINLLM_TRACE_CONCAT(trace_scope_, __LINE__)(category, name)
+#else
+#define BRAINLLM_TRACE_SCOPE(category, name) ((void)0)
+#endif
+
+namespace BrainLLM {
+
+struct TraceEvent {
+    const char* category;
+    const char* name;
+    uint32_t thread_id;
+    double start_us;       // Microseconds since the tracer's epoch
+    double duration_us;
+};
+
+// Process-wide trace collector. Each thread writes to its own fixed-size
+// ring buffer without locks; the oldest events are overwritten once a
+// buffer wraps. Timestamps come from the TSC on x86-64 and from
+// steady_clock elsewhere, and are converted to microseconds only when the
+// trace is collected.
+class Tracer {
+public:
+    static constexpr size_t kEventsPerThread = 8192;
+    
+    static Tracer& instance();
+    
+    void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool is_enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    
+    void record(const char* category, const char* name, uint64_t start_ticks, uint64_t end_ticks);
+    
+    // Snapshot of every buffered event, oldest first within each thread
+    std::vector<TraceEvent> collect() const;
+    void clear();
+    
+    // Chrome trace-event JSON, loadable in chrome://tracing and Perfetto
+    std::string chrome_trace_json() const;
+    bool write_chrome_trace(const std::string& path) const;
+    
+    static uint64_t now_ticks();
+
+private:
+    // Each slot is guarded by a sequence number so the collector can skip
+    // a slot the owning thread is rewriting at the same moment
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<const char*> category{nullptr};
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> start{0};
+        std::atomic<uint64_t> end{0};
+    };
+    
+    struct ThreadBuffer {
+        uint32_t thread_id;
+        std::atomic<uint64_t> head{0};   // Total events ever written
+        Slot events[kEventsPerThread];
+    };
+    
+    // Hands the owning thread's buffer back to the free list when it exits
+    struct BufferLease {
+        ThreadBuffer* buffer = nullptr;
+        ~BufferLease();
+    };
+    
+    Tracer();
+    
+    ThreadBuffer& local_buffer();
+    void release_buffer(ThreadBuffer* buffer);
+    double ticks_per_microsecond() const;
+    
+    std::atomic<bool> enabled_;
+    std::atomic<uint64_t> cleared_ticks_;  // Events starting before this are dropped
+    uint64_t epoch_ticks_;
+    uint64_t epoch_ns_;
+    
+    mutable std::mutex buffers_mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::vector<ThreadBuffer*> free_buffers_;  // Owned by buffers_; their threads exited
+};
+
+class TraceScope {
+public:
+    TraceScope(const char* category, const char* name)
+        : category_(category), name_(name),
+          start_(Tracer::instance().is_enabled() ? Tracer::now_ticks() : 0) {}
+    
+    ~TraceScope() {
+        if (start_ != 0) {
+            Tracer::instance().record(category_, name_, start_, Tracer::now_ticks());
+        }
+    }
+    
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* category_;
+    const char* name_;
+    uint64_t start_;
+};
+
+} // namespace BrainLLM
@@ -1,6 +1,7 @@
 #include "advanced_architectures.h"
 #include <cmath>
 #include <algorithm>
+#include <cstring>
 
 namespace BrainLLM {
 
@@ -86,19 +87,53 @@ std::vector<float> TransformerModule::apply_residual(const std::vector<float>& i
 // EMBEDDING LAYER
 // ========================================
 
-EmbeddingLayer::EmbeddingLayer(int vocab_size, int embedding_dim)
-    : vocab_size_(vocab_size), embedding_dim_(embedding_dim) {
+EmbeddingLayer::EmbeddingLayer(int vocab_size, int embedding_dim, StoragePrecision precision)
+    : vocab_size_(std::max(0, vocab_size)), embedding_dim_(std::max(0, embedding_dim)), precision_(precision) {
+    // Pad rows to whole 64-byte lines so every row starts aligned
+    size_t per_line = 64 / storage_bytes(precision_);
+    row_stride_ = (embedding_dim_ + per_line - 1) / per_line * per_line;
     initialize_embeddings();
 }
 
-std::vector<float> EmbeddingLayer::embed_token(int token_id) {
-    if (embedding_matrix_.find(token_id) != embedding_matrix_.end()) {
-        return embedding_matrix_[token_id];
+std::vector<float> EmbeddingLayer::embed_token(int token_id) const {
+    std::vector<float> embedding(embedding_dim_);
+    gather({token_id}, embedding.data());
+    return embedding;
+}
+
+FloatSpan EmbeddingLayer::lookup(int token_id) const {
+    if (precision_ != StoragePrecision::Float32 || !valid_token(token_id)) {
+        return FloatSpan();
+    }
+    return FloatSpan{table_.data() + token_id * row_stride_, static_cast<size_t>(embedding_dim_)};
+}
+
+void EmbeddingLayer::gather(const std::vector<int>& tokens, float* out) const {
+    size_t dim = embedding_dim_;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        float* row = out + i * dim;
+        int token = tokens[i];
+        if (!valid_token(token)) {
+            std::fill(row, row + dim, 0.0f);
+        } else if (precision_ == StoragePrecision::Float32) {
+            std::memcpy(row, table_.data() + token * row_stride_, dim * sizeof(float));
+        } else {
+            widen_to_float(half_table_.data() + token * row_stride_, row, dim, precision_);
+        }
     }
-    return std::vector<float>(embedding_dim_, 0.0f);
+}
+
+std::vector<float> EmbeddingLayer::embed_sequence(const std::vector<int>& tokens) const {
+    std::vector<float> embeddings(tokens.size() * embedding_dim_);
+    gather(tokens, embeddings.data());
+    return embeddings;
 }
 
 std::vector<int> EmbeddingLayer::tokenize(const std::string& text) {
+    if (tokenizer_) {
+        return tokenizer_->encode(text);
+    }
+    
     std::vector<int> tokens;
     for (char c : text) {
         tokens.push_back(static_cast<int>(c) % vocab_size_);
@@ -107,6 +142,10 @@ std::vector<int> EmbeddingLayer::tokenize(const std::string& text) {
 }
 
 std::string EmbeddingLayer::detokenize(const std::vector<int>& tokens) {
+    if (tokenizer_) {
+        return tokenizer_->decode(tokens);
+    }
+    
     std::string text;
     for (int token : tokens) {
         text += char(token % 256);
@@ -114,6 +153,10 @@ std::string EmbeddingLayer::detokenize(const std::vector<int>& tokens) {
     return text;
 }
 
+void EmbeddingLayer::set_tokenizer(std::shared_ptr<const BpeTokenizer> tokenizer) {
+    tokenizer_ = std::move(tokenizer);
+}
+
 std::vector<float> EmbeddingLayer::get_positional_encoding(int position, int dim) {
     std::vector<float> encoding(dim);
     for (int i = 0; i < dim; ++i) {
@@ -128,17 +171,56 @@ std::vector<float> EmbeddingLayer::get_positional_encoding(int position, int dim
 }
 
 void EmbeddingLayer::update_embeddings(const std::vector<int>& tokens,
-                                      const std::vector<float>& gradients) {
-    // Update embeddings based on gradients
+                                      const std::vector<float>& gradients,
+                                      float learning_rate) {
+    size_t dim = embedding_dim_;
+    size_t rows = dim == 0 ? 0 : std::min(tokens.size(), gradients.size() / dim);
+    std::vector<float> widened(precision_ == StoragePrecision::Float32 ? 0 : dim);
+    
+    for (size_t i = 0; i < rows; ++i) {
+        int token = tokens[i];
+        if (!valid_token(token)) continue;
+        const float* gradient = gradients.data() + i * dim;
+        
+        if (precision_ == StoragePrecision::Float32) {
+            float* row = table_.data() + token * row_stride_;
+            for (size_t j = 0; j < dim; ++j) {
+                row[j] -= learning_rate * gradient[j];
+            }
+        } else {
+            // Half-precision rows are updated in fp32 and rounded once
+            uint16_t* row = half_table_.data() + token * row_stride_;
+            widen_to_float(row, widened.data(), dim, precision_);
+            for (size_t j = 0; j < dim; ++j) {
+                widened[j] -= learning_rate * gradient[j];
+            }
+            narrow_from_float(widened.data(), row, dim, precision_);
+        }
+    }
+}
+
+size_t EmbeddingLayer::memory_bytes() const {
+    return table_.size() * sizeof(float) + half_table_.size() * sizeof(uint16_t);
 }
 
 void EmbeddingLayer::initialize_embeddings() {
-    for (int i = 0; i < vocab_size_; ++i) {
-        std::vector<float> embedding(embedding_dim_);
+    size_t rows = vocab_size_;
+    std::vector<float> row(embedding_dim_);
+    if (precision_ == StoragePrecision::Float32) {
+        table_.assign(rows * row_stride_, 0.0f);
+    } else {
+        half_table_.assign(rows * row_stride_, 0);
+    }
+    
+    for (size_t i = 0; i < rows; ++i) {
         for (int j = 0; j < embedding_dim_; ++j) {
-            embedding[j] = (float)(i * j) / (vocab_size_ * embedding_dim_);
+            row[j] = (float)(i * j) / (vocab_size_ * embedding_dim_);
+        }
+        if (precision_ == StoragePrecision::Float32) {
+            std::copy(row.begin(), row.end(), table_.begin() + i * row_stride_);
+        } else {
+            narrow_from_float(row.data(), half_table_.data() + i * row_stride_, row.size(), precision_);
         }
-        embedding_matrix_[i] = embedding;
     }
 }
 
@@ -1,4 +1,5 @@
 #include "comprehensive_brain.h"
+#include "trace.h"
 
 namespace BrainLLM {
 
@@ -27,6 +28,8 @@ ComprehensiveBrain::ComprehensiveBrain(const BrainConfig& config)
 }
 
 std::string ComprehensiveBrain::process_safely(const std::string& input) {
+    BRAINLLM_TRACE_SCOPE("safety", "ComprehensiveBrain::process_safely");
+    
     // 1. Security check
     if (!security_monitor_.validate_input(input)) {
         return "ERROR: Input failed security validation";
@@ -0,0 +1,168 @@
+#include "admission_control.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace BrainLLM {
+
+namespace {
+
+// Weight of the newest sample in the smoothed service time
+constexpr double kServiceSmoothing = 0.1;
+
+} // namespace
+
+AdmissionController::AdmissionController(const AdmissionPolicy& policy)
+    : policy_(policy), connections_(0), queued_(0), service_ns_(0.0) {}
+
+void AdmissionController::set_policy(const AdmissionPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    policy_ = policy;
+    buckets_.clear();
+}
+
+AdmissionPolicy AdmissionController::get_policy() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return policy_;
+}
+
+bool AdmissionController::acquire_connection() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (policy_.max_connections > 0 && connections_ >= static_cast<size_t>(policy_.max_connections)) {
+        runtime_metrics().connections_rejected.add();
+        return false;
+    }
+    ++connections_;
+    return true;
+}
+
+void AdmissionController::release_connection() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (connections_ > 0) --connections_;
+}
+
+std::string AdmissionController::presented_key(const HttpRequest& request) {
+    std::string key = request.header("x-api-key");
+    if (!key.empty()) return key;
+    
+    std::string authorization = request.header("authorization");
+    if (authorization.compare(0, 7, "Bearer ") == 0) {
+        return authorization.substr(7);
+    }
+    return std::string();
+}
+
+bool AdmissionController::authorized(const std::string& presented_key) const {
+    if (policy_.api_key.empty()) return true;
+    if (presented_key.size() != policy_.api_key.size()) return false;
+    
+    // Compare every byte so the time taken does not reveal the matching prefix
+    unsigned char difference = 0;
+    for (size_t i = 0; i < presented_key.size(); ++i) {
+        difference |= static_cast<unsigned char>(presented_key[i] ^ policy_.api_key[i]);
+    }
+    return difference == 0;
+}
+
+AdmissionController::Decision AdmissionController::admit(const HttpRequest& request,
+                                                         const std::string& client_address,
+                                                         int& retry_after_seconds) {
+    RuntimeMetrics& metrics = runtime_metrics();
+    std::string key = presented_key(request);
+    uint64_t now = monotonic_nanoseconds();
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    retry_after_seconds = 0;
+    
+    if (!authorized(key)) {
+        metrics.requests_unauthorized.add();
+        return Decision::Unauthorized;
+    }
+    
+    if (policy_.requests_per_second > 0.0 &&
+        !take_token(client_address, now, retry_after_seconds)) {
+        metrics.requests_rate_limited.add();
+        return Decision::RateLimited;
+    }
+    
+    // Shed now rather than let the request time out after queueing
+    double expected_wait_ns = queued_ * service_ns_ / std::max(1, policy_.workers);
+    bool queue_full = policy_.max_queued_requests > 0 && queued_ >= policy_.max_queued_requests;
+    bool too_slow = policy_.deadline_ms > 0 && expected_wait_ns > policy_.deadline_ms * 1e6;
+    if (queue_full || too_slow) {
+        retry_after_seconds = std::max(1, static_cast<int>(std::ceil(expected_wait_ns / 1e9)));
+        metrics.requests_shed.add();
+        return Decision::Overloaded;
+    }
+    
+    ++queued_;
+    metrics.request_queue_depth.set(static_cast<int64_t>(queued_));
+    return Decision::Admit;
+}
+
+bool AdmissionController::take_token(const std::string& client, uint64_t now, int& retry_after_seconds) {
+    if (buckets_.size() >= kMaxTrackedClients && buckets_.find(client) == buckets_.end()) {
+        prune_buckets(now);
+    }
+    
+    double capacity = std::max(1.0, policy_.burst);
+    auto inserted = buckets_.emplace(client, TokenBucket{capacity, now});
+    TokenBucket& bucket = inserted.first->second;
+    
+    double refill = (now - bucket.updated_ns) / 1e9 * policy_.requests_per_second;
+    bucket.tokens = std::min(capacity, bucket.tokens + refill);
+    bucket.updated_ns = now;
+    
+    if (bucket.tokens < 1.0) {
+        retry_after_seconds = std::max(1, static_cast<int>(std::ceil((1.0 - bucket.tokens) /
+                                                                      policy_.requests_per_second)));
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+void AdmissionController::prune_buckets(uint64_t now) {
+    // A bucket that would have refilled completely carries no state
+    double refill_ns = std::max(1.0, policy_.burst) / policy_.requests_per_second * 1e9;
+    for (auto it = buckets_.begin(); it != buckets_.end(); ) {
+        if (now - it->second.updated_ns >= refill_ns) {
+            it = buckets_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool AdmissionController::start(uint64_t enqueued_ns) {
+    uint64_t waited = monotonic_nanoseconds() - enqueued_ns;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queued_ > 0) --queued_;
+    runtime_metrics().request_queue_depth.set(static_cast<int64_t>(queued_));
+    
+    if (policy_.deadline_ms > 0 && waited > policy_.deadline_ms * 1000000ULL) {
+        runtime_metrics().requests_shed.add();
+        return false;
+    }
+    return true;
+}
+
+void AdmissionController::finish(uint64_t service_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    service_ns_ = service_ns_ == 0.0
+        ? static_cast<double>(service_ns)
+        : service_ns_ + kServiceSmoothing * (static_cast<double>(service_ns) - service_ns_);
+}
+
+size_t AdmissionController::get_connection_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connections_;
+}
+
+size_t AdmissionController::get_queued_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_;
+}
+
+} // namespace BrainLLM
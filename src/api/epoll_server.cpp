@@ -0,0 +1,521 @@
+#include "epoll_server.h"
+#include "metrics.h"
+#include "trace.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace BrainLLM {
+
+namespace {
+
+constexpr int kMaxEvents = 256;
+constexpr size_t kReadChunk = 64 * 1024;
+constexpr size_t kMaxIovecs = 64;
+constexpr size_t kMaxSpareBuffers = 4;
+
+} // namespace
+
+EpollServer::EpollServer(std::shared_ptr<RequestHandler> handler, int port, int num_threads, int num_workers)
+    : handler_(handler), port_(port), num_threads_(num_threads), num_workers_(num_workers),
+      running_(false), stopping_workers_(false) {
+    if (num_threads_ <= 0) {
+        num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // More workers than cores only adds contention on the engine
+    if (num_workers_ <= 0) {
+        num_workers_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+    set_api_settings(ConfigManager::default_api_settings());
+}
+
+EpollServer::~EpollServer() {
+    stop();
+}
+
+bool EpollServer::start() {
+    if (running_) return true;
+    
+    for (int i = 0; i < num_threads_; ++i) {
+        auto loop = std::make_unique<EventLoop>();
+        if (!open_loop(*loop)) {
+            close_loop(*loop);
+            for (auto& opened : loops_) {
+                close_loop(*opened);
+            }
+            loops_.clear();
+            return false;
+        }
+        loops_.push_back(std::move(loop));
+    }
+    
+    running_ = true;
+    stopping_workers_ = false;
+    for (int i = 0; i < num_workers_; ++i) {
+        workers_.emplace_back([this]() { run_worker(); });
+    }
+    for (auto& loop : loops_) {
+        EventLoop* raw = loop.get();
+        loop->thread = std::thread([this, raw]() { run_loop(*raw); });
+    }
+    return true;
+}
+
+void EpollServer::stop() {
+    if (!running_.exchange(false)) return;
+    
+    for (auto& loop : loops_) {
+        uint64_t one = 1;
+        ssize_t ignored = write(loop->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+    }
+    
+    // Queued requests are dropped; running ones still post to the loops'
+    // eventfds, so those stay open until every worker has exited
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        stopping_workers_ = true;
+        jobs_.clear();
+    }
+    jobs_ready_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    
+    for (auto& loop : loops_) {
+        close_loop(*loop);
+    }
+    loops_.clear();
+}
+
+bool EpollServer::is_running() const {
+    return running_;
+}
+
+void EpollServer::set_api_settings(const ConfigManager::APISettings& settings) {
+    AdmissionPolicy policy;
+    policy.max_connections = settings.max_connections;
+    policy.api_key = settings.api_key;
+    policy.requests_per_second = settings.requests_per_second;
+    policy.burst = settings.burst;
+    policy.max_queued_requests = static_cast<size_t>(std::max(0, settings.max_queued_requests));
+    policy.deadline_ms = static_cast<uint64_t>(std::max(0, settings.request_deadline_ms));
+    policy.workers = num_workers_;
+    admission_.set_policy(policy);
+}
+
+bool EpollServer::open_loop(EventLoop& loop) {
+    loop.listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (loop.listen_fd < 0) return false;
+    
+    // Every loop binds the same port; the kernel load-balances accepts
+    int enable = 1;
+    setsockopt(loop.listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if (setsockopt(loop.listen_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) return false;
+    
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(port_));
+    if (bind(loop.listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) return false;
+    if (listen(loop.listen_fd, SOMAXCONN) < 0) return false;
+    
+    loop.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    loop.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop.epoll_fd < 0 || loop.wake_fd < 0) return false;
+    
+    epoll_event listen_event{};
+    listen_event.events = EPOLLIN | EPOLLET;
+    listen_event.data.fd = loop.listen_fd;
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, loop.listen_fd, &listen_event) < 0) return false;
+    
+    epoll_event wake_event{};
+    wake_event.events = EPOLLIN;
+    wake_event.data.fd = loop.wake_fd;
+    return epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, loop.wake_fd, &wake_event) == 0;
+}
+
+void EpollServer::close_loop(EventLoop& loop) {
+    for (auto& entry : loop.connections) {
+        close(entry.first);
+        admission_.release_connection();
+    }
+    loop.connections.clear();
+    loop.completions.clear();
+    
+    for (int* fd : {&loop.listen_fd, &loop.epoll_fd, &loop.wake_fd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void EpollServer::run_loop(EventLoop& loop) {
+    epoll_event events[kMaxEvents];
+    
+    while (running_) {
+        int count = epoll_wait(loop.epoll_fd, events, kMaxEvents, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t flags = events[i].events;
+            
+            if (fd == loop.listen_fd) {
+                accept_connections(loop);
+                continue;
+            }
+            if (fd == loop.wake_fd) {
+                // Either stop() flipped running_ or workers posted responses
+                uint64_t ignored;
+                while (read(loop.wake_fd, &ignored, sizeof(ignored)) > 0) {}
+                drain_completions(loop);
+                continue;
+            }
+            
+            auto it = loop.connections.find(fd);
+            if (it == loop.connections.end()) continue;
+            Connection& connection = *it->second;
+            
+            if (flags & (EPOLLERR | EPOLLHUP)) {
+                close_connection(loop, fd);
+                continue;
+            }
+            
+            if (!service_connection(loop, connection)) {
+                close_connection(loop, fd);
+            }
+        }
+    }
+}
+
+void EpollServer::accept_connections(EventLoop& loop) {
+    while (true) {
+        sockaddr_in peer{};
+        socklen_t peer_length = sizeof(peer);
+        int fd = accept4(loop.listen_fd, reinterpret_cast<sockaddr*>(&peer), &peer_length,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN means the backlog is drained; anything else (e.g. EMFILE)
+            // leaves the remaining connections for the next edge
+            break;
+        }
+        
+        if (!admission_.acquire_connection()) {
+            // Over the cap: answer once and hang up without reading anything
+            PendingResponse response = rejection(AdmissionController::Decision::Overloaded, 1, false);
+            std::string data = http_response_head(response.status_code, response.body.size(), false,
+                                                  response.content_type, response.retry_after_seconds) +
+                               response.body;
+            ssize_t ignored = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            (void)ignored;
+            close(fd);
+            continue;
+        }
+        
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = fd;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            admission_.release_connection();
+            continue;
+        }
+        
+        char address[INET_ADDRSTRLEN] = {};
+        inet_ntop(AF_INET, &peer.sin_addr, address, sizeof(address));
+        
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        connection->id = loop.next_connection_id++;
+        connection->client_address = address;
+        loop.connections[fd] = std::move(connection);
+    }
+}
+
+void EpollServer::close_connection(EventLoop& loop, int fd) {
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    loop.connections.erase(fd);
+    admission_.release_connection();
+}
+
+bool EpollServer::service_connection(EventLoop& loop, Connection& connection) {
+    // Edge-triggered, so every event drains as far as possible: output first,
+    // since a socket that became writable may be what unblocks reading, then
+    // input. Responses answered on the loop itself (rejections, parse errors)
+    // pause reading again, so repeat until the kernel pushes back or only
+    // workers can make progress; their completions bring the loop back.
+    while (true) {
+        if (!flush_connection(connection)) return false;
+        if (!connection.out_queue.empty()) return true;  // Wait for EPOLLOUT
+        if (!read_connection(loop, connection)) return false;
+        if (connection.out_queue.empty()) return true;
+    }
+}
+
+bool EpollServer::read_connection(EventLoop& loop, Connection& connection) {
+    char buffer[kReadChunk];
+    
+    // Requests already buffered go first, then the socket is read one chunk
+    // at a time only while the pipeline has room and earlier responses have
+    // left for the kernel, so a peer that never reads cannot grow either the
+    // parser buffer or the output queue. Stopping short of EAGAIN is safe
+    // under edge triggering: a completion or EPOLLOUT brings the loop back
+    // through service_connection() to resume.
+    handle_requests(loop, connection);
+    while (!connection.closing && !connection.peer_closed && connection.out_queue.empty() &&
+           connection.next_sequence - connection.next_to_write < kMaxPipelinedRequests) {
+        ssize_t received;
+        {
+            BRAINLLM_TRACE_SCOPE("http", "read");
+            received = read(connection.fd, buffer, sizeof(buffer));
+        }
+        if (received > 0) {
+            connection.parser.feed(buffer, static_cast<size_t>(received));
+        } else if (received == 0) {
+            // Peer finished sending; handle_requests() closes once drained
+            connection.peer_closed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        handle_requests(loop, connection);
+    }
+    return true;
+}
+
+void EpollServer::handle_requests(EventLoop& loop, Connection& connection) {
+    HttpRequest request;
+    bool drained = false;
+    
+    // Dispatch every complete request; pipelined requests run concurrently
+    // and their responses are reordered in write_completed()
+    while (!connection.closing &&
+           connection.next_sequence - connection.next_to_write < kMaxPipelinedRequests) {
+        auto result = connection.parser.next(request);
+        if (result == HttpParser::Result::NeedMore) {
+            drained = true;
+            break;
+        }
+        
+        uint64_t sequence = connection.next_sequence++;
+        
+        if (result == HttpParser::Result::Error) {
+            connection.closing = true;
+            connection.completed.emplace(sequence, PendingResponse{
+                connection.parser.error_status(), std::string(), "application/json", false});
+            break;
+        }
+        
+        if (!request.keep_alive) {
+            connection.closing = true;
+        }
+        
+        int retry_after = 0;
+        auto decision = admission_.admit(request, connection.client_address, retry_after);
+        if (decision != AdmissionController::Decision::Admit) {
+            connection.completed.emplace(sequence, rejection(decision, retry_after, request.keep_alive));
+            continue;
+        }
+        dispatch(loop, connection, sequence, std::move(request));
+    }
+    
+    // Half-close: answer what was already sent, then close
+    if (drained && connection.peer_closed) {
+        connection.closing = true;
+    }
+    write_completed(connection);
+}
+
+void EpollServer::dispatch(EventLoop& loop, Connection& connection, uint64_t sequence, HttpRequest request) {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        jobs_.push_back(Job{&loop, connection.fd, connection.id, sequence, std::move(request),
+                            take_spare_buffer(connection), monotonic_nanoseconds()});
+    }
+    jobs_ready_.notify_one();
+}
+
+void EpollServer::run_worker() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex_);
+            jobs_ready_.wait(lock, [this]() { return stopping_workers_ || !jobs_.empty(); });
+            if (stopping_workers_) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        
+        BRAINLLM_TRACE_SCOPE("http", "dispatch");
+        PendingResponse response;
+        if (!admission_.start(job.enqueued_ns)) {
+            // Waited past the deadline; the client has likely given up
+            response = rejection(AdmissionController::Decision::Overloaded, 1, job.request.keep_alive);
+        } else {
+            uint64_t started = monotonic_nanoseconds();
+            ApiResponse result = handler_->handle_request(job.request, std::move(job.buffer));
+            admission_.finish(monotonic_nanoseconds() - started);
+            response = PendingResponse{result.status_code, std::move(result.body), result.content_type,
+                                       job.request.keep_alive};
+        }
+        post_completion(*job.loop, Completion{job.fd, job.connection_id, job.sequence, std::move(response)});
+    }
+}
+
+void EpollServer::post_completion(EventLoop& loop, Completion completion) {
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(loop.completions_mutex);
+        was_empty = loop.completions.empty();
+        loop.completions.push_back(std::move(completion));
+    }
+    
+    // One wakeup per batch; the loop drains everything posted before it reads
+    if (was_empty) {
+        uint64_t one = 1;
+        ssize_t ignored = write(loop.wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void EpollServer::drain_completions(EventLoop& loop) {
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(loop.completions_mutex);
+        completions.swap(loop.completions);
+    }
+    
+    std::vector<int> touched;
+    for (auto& completion : completions) {
+        auto it = loop.connections.find(completion.fd);
+        if (it == loop.connections.end() || it->second->id != completion.connection_id) {
+            continue;  // Client already went away
+        }
+        it->second->completed.emplace(completion.sequence, std::move(completion.response));
+        touched.push_back(completion.fd);
+    }
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    
+    for (int fd : touched) {
+        Connection& connection = *loop.connections[fd];
+        
+        // Writing frees pipeline slots, so resume parsing buffered requests
+        // and reading what was left in the socket while the pipeline was full
+        write_completed(connection);
+        if (!service_connection(loop, connection)) {
+            close_connection(loop, fd);
+        }
+    }
+}
+
+void EpollServer::write_completed(Connection& connection) {
+    while (true) {
+        auto next = connection.completed.find(connection.next_to_write);
+        if (next == connection.completed.end()) return;
+        
+        queue_response(connection, std::move(next->second));
+        connection.completed.erase(next);
+        ++connection.next_to_write;
+    }
+}
+
+bool EpollServer::flush_connection(Connection& connection) {
+    BRAINLLM_TRACE_SCOPE("http", "write");
+    iovec iov[kMaxIovecs];
+    
+    while (!connection.out_queue.empty()) {
+        size_t count = 0;
+        for (auto it = connection.out_queue.begin();
+             it != connection.out_queue.end() && count < kMaxIovecs; ++it, ++count) {
+            size_t offset = (count == 0) ? connection.out_offset : 0;
+            iov[count].iov_base = const_cast<char*>(it->data()) + offset;
+            iov[count].iov_len = it->size() - offset;
+        }
+        
+        // sendmsg is writev with flags, so a vanished peer cannot raise SIGPIPE
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;  // Wait for EPOLLOUT
+        }
+        
+        size_t remaining = static_cast<size_t>(sent);
+        while (remaining > 0) {
+            size_t available = connection.out_queue.front().size() - connection.out_offset;
+            if (remaining < available) {
+                connection.out_offset += remaining;
+                break;
+            }
+            remaining -= available;
+            if (connection.spare_buffers.size() < kMaxSpareBuffers) {
+                connection.spare_buffers.push_back(std::move(connection.out_queue.front()));
+            }
+            connection.out_queue.pop_front();
+            connection.out_offset = 0;
+        }
+    }
+    
+    // Close once every response owed to the client has been sent
+    return !(connection.closing && connection.next_to_write == connection.next_sequence);
+}
+
+std::string EpollServer::take_spare_buffer(Connection& connection) {
+    if (connection.spare_buffers.empty()) return std::string();
+    
+    std::string buffer = std::move(connection.spare_buffers.back());
+    connection.spare_buffers.pop_back();
+    return buffer;
+}
+
+void EpollServer::queue_response(Connection& connection, PendingResponse response) {
+    connection.out_queue.push_back(http_response_head(response.status_code, response.body.size(),
+                                                      response.keep_alive, response.content_type,
+                                                      response.retry_after_seconds));
+    if (!response.body.empty()) {
+        connection.out_queue.push_back(std::move(response.body));
+    }
+}
+
+EpollServer::PendingResponse EpollServer::rejection(AdmissionController::Decision decision,
+                                                   int retry_after_seconds, bool keep_alive) {
+    switch (decision) {
+        case AdmissionController::Decision::Unauthorized:
+            return {401, "{\"error\":\"Missing or invalid API key\"}", "application/json", keep_alive};
+        case AdmissionController::Decision::RateLimited:
+            return {429, "{\"error\":\"Rate limit exceeded\"}", "application/json", keep_alive,
+                    retry_after_seconds};
+        default:
+            return {503, "{\"error\":\"Server overloaded\"}", "application/json", keep_alive,
+                    retry_after_seconds};
+    }
+}
+
+} // namespace BrainLLM
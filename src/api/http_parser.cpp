@@ -0,0 +1,282 @@
+#include "http_parser.h"
+#include <algorithm>
+#include <cctype>
+
+namespace BrainLLM {
+
+namespace {
+
+std::string to_lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+std::string trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(start, end - start + 1);
+}
+
+bool contains_token(const std::string& value, const std::string& token) {
+    return to_lower(value).find(token) != std::string::npos;
+}
+
+} // namespace
+
+std::string http_response_head(int status_code, size_t content_length, bool keep_alive,
+                               const char* content_type, int retry_after_seconds) {
+    std::string head;
+    head.reserve(128);
+    head += "HTTP/1.1 ";
+    head += std::to_string(status_code);
+    head += ' ';
+    head += http_status_text(status_code);
+    head += "\r\nContent-Type: ";
+    head += content_type;
+    head += "\r\nContent-Length: ";
+    head += std::to_string(content_length);
+    if (retry_after_seconds > 0) {
+        head += "\r\nRetry-After: ";
+        head += std::to_string(retry_after_seconds);
+    }
+    head += keep_alive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+    return head;
+}
+
+const char* http_status_text(int status_code) {
+    switch (status_code) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        case 505: return "HTTP Version Not Supported";
+        default: return "Error";
+    }
+}
+
+std::string HttpRequest::header(const std::string& name) const {
+    auto it = headers.find(to_lower(name));
+    return it != headers.end() ? it->second : std::string();
+}
+
+HttpParser::HttpParser(size_t max_header_bytes, size_t max_body_bytes)
+    : read_pos_(0), stage_(Stage::Head), body_remaining_(0),
+      max_header_bytes_(max_header_bytes), max_body_bytes_(max_body_bytes),
+      error_status_(0) {}
+
+void HttpParser::feed(const char* data, size_t size) {
+    buffer_.append(data, size);
+}
+
+HttpParser::Result HttpParser::next(HttpRequest& request) {
+    if (error_status_ != 0) return Result::Error;
+    
+    Result result = Result::NeedMore;
+    switch (stage_) {
+        case Stage::Head:
+            result = parse_head();
+            if (result != Result::Complete) return result;
+            if (stage_ == Stage::Head) break;  // No body
+            // Fall through to read the body from the same buffer
+            result = (stage_ == Stage::Body) ? parse_body() : parse_chunked();
+            break;
+        case Stage::Body:
+            result = parse_body();
+            break;
+        default:
+            result = parse_chunked();
+            break;
+    }
+    
+    if (result != Result::Complete) return result;
+    
+    request = std::move(current_);
+    current_ = HttpRequest();
+    stage_ = Stage::Head;
+    compact();
+    return Result::Complete;
+}
+
+void HttpParser::reset() {
+    buffer_.clear();
+    read_pos_ = 0;
+    stage_ = Stage::Head;
+    current_ = HttpRequest();
+    body_remaining_ = 0;
+    error_status_ = 0;
+}
+
+HttpParser::Result HttpParser::parse_head() {
+    // Tolerate stray CRLFs between pipelined requests
+    while (buffer_.compare(read_pos_, 2, "\r\n") == 0) {
+        read_pos_ += 2;
+    }
+    
+    size_t head_end = buffer_.find("\r\n\r\n", read_pos_);
+    if (head_end == std::string::npos) {
+        if (buffered_bytes() > max_header_bytes_) return fail(431);
+        return Result::NeedMore;
+    }
+    if (head_end - read_pos_ > max_header_bytes_) return fail(431);
+    
+    std::string line;
+    read_line(line);
+    
+    size_t first_space = line.find(' ');
+    size_t second_space = line.find(' ', first_space + 1);
+    if (first_space == std::string::npos || second_space == std::string::npos) return fail(400);
+    
+    current_.method = line.substr(0, first_space);
+    current_.path = line.substr(first_space + 1, second_space - first_space - 1);
+    current_.version = line.substr(second_space + 1);
+    if (current_.method.empty() || current_.path.empty()) return fail(400);
+    if (current_.version != "HTTP/1.1" && current_.version != "HTTP/1.0") return fail(505);
+    
+    while (read_line(line) && !line.empty()) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos || colon == 0) return fail(400);
+        
+        std::string name = to_lower(line.substr(0, colon));
+        std::string value = trim(line.substr(colon + 1));
+        
+        auto existing = current_.headers.find(name);
+        if (existing != current_.headers.end()) {
+            existing->second += ", " + value;
+        } else {
+            current_.headers.emplace(std::move(name), std::move(value));
+        }
+    }
+    
+    std::string connection = current_.header("connection");
+    if (current_.version == "HTTP/1.1") {
+        current_.keep_alive = !contains_token(connection, "close");
+    } else {
+        current_.keep_alive = contains_token(connection, "keep-alive");
+    }
+    
+    std::string transfer_encoding = current_.header("transfer-encoding");
+    std::string content_length = current_.header("content-length");
+    
+    if (!transfer_encoding.empty()) {
+        // Both framings at once is a request-smuggling vector; refuse it
+        if (!content_length.empty()) return fail(400);
+        if (to_lower(transfer_encoding) != "chunked") return fail(501);
+        stage_ = Stage::ChunkSize;
+        return Result::Complete;
+    }
+    
+    if (!content_length.empty()) {
+        if (!std::all_of(content_length.begin(), content_length.end(),
+                         [](unsigned char c) { return std::isdigit(c); }) ||
+            content_length.size() > 18) {
+            return fail(400);
+        }
+        body_remaining_ = std::stoull(content_length);
+        if (body_remaining_ > max_body_bytes_) return fail(413);
+        if (body_remaining_ > 0) {
+            stage_ = Stage::Body;
+        }
+    }
+    
+    return Result::Complete;
+}
+
+HttpParser::Result HttpParser::parse_body() {
+    if (buffered_bytes() < body_remaining_) return Result::NeedMore;
+    
+    current_.body.assign(buffer_, read_pos_, body_remaining_);
+    read_pos_ += body_remaining_;
+    body_remaining_ = 0;
+    return Result::Complete;
+}
+
+HttpParser::Result HttpParser::parse_chunked() {
+    std::string line;
+    
+    while (true) {
+        switch (stage_) {
+            case Stage::ChunkSize: {
+                if (!read_line(line)) {
+                    if (buffered_bytes() > 1024) return fail(400);
+                    return Result::NeedMore;
+                }
+                
+                // Chunk extensions after ';' are ignored
+                std::string size_text = trim(line.substr(0, line.find(';')));
+                if (size_text.empty() || size_text.size() > 15 ||
+                    !std::all_of(size_text.begin(), size_text.end(),
+                                 [](unsigned char c) { return std::isxdigit(c); })) {
+                    return fail(400);
+                }
+                
+                size_t chunk_size = std::stoull(size_text, nullptr, 16);
+                if (chunk_size == 0) {
+                    stage_ = Stage::ChunkTrailer;
+                    break;
+                }
+                if (current_.body.size() + chunk_size > max_body_bytes_) return fail(413);
+                
+                body_remaining_ = chunk_size;
+                stage_ = Stage::ChunkData;
+                break;
+            }
+            case Stage::ChunkData: {
+                if (buffered_bytes() < body_remaining_ + 2) return Result::NeedMore;
+                if (buffer_.compare(read_pos_ + body_remaining_, 2, "\r\n") != 0) return fail(400);
+                
+                current_.body.append(buffer_, read_pos_, body_remaining_);
+                read_pos_ += body_remaining_ + 2;
+                body_remaining_ = 0;
+                stage_ = Stage::ChunkSize;
+                break;
+            }
+            case Stage::ChunkTrailer: {
+                if (!read_line(line)) {
+                    if (buffered_bytes() > max_header_bytes_) return fail(431);
+                    return Result::NeedMore;
+                }
+                // Trailer fields are accepted and discarded
+                if (line.empty()) return Result::Complete;
+                break;
+            }
+            default:
+                return fail(500);
+        }
+    }
+}
+
+HttpParser::Result HttpParser::fail(int status) {
+    error_status_ = status;
+    return Result::Error;
+}
+
+void HttpParser::compact() {
+    // Drop consumed bytes once they dominate the buffer, keeping appends amortized O(1)
+    if (read_pos_ == buffer_.size()) {
+        buffer_.clear();
+        read_pos_ = 0;
+    } else if (read_pos_ > 4096 && read_pos_ * 2 > buffer_.size()) {
+        buffer_.erase(0, read_pos_);
+        read_pos_ = 0;
+    }
+}
+
+bool HttpParser::read_line(std::string& line) {
+    size_t end = buffer_.find("\r\n", read_pos_);
+    if (end == std::string::npos) return false;
+    
+    line.assign(buffer_, read_pos_, end - read_pos_);
+    read_pos_ = end + 2;
+    return true;
+}
+
+} // namespace BrainLLM
@@ -0,0 +1,440 @@
+#include "json_reader.h"
+#include <charconv>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BRAINLLM_JSON_SSE2 1
+#endif
+
+namespace BrainLLM {
+
+namespace {
+
+bool is_whitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool is_delimiter(char c) {
+    return is_whitespace(c) || c == ',' || c == '}' || c == ']' || c == ':';
+}
+
+// Position of the quote closing the string that opens at `open`, or npos
+size_t find_string_end(std::string_view json, size_t open) {
+    size_t pos = open + 1;
+    const size_t size = json.size();
+    
+    while (pos < size) {
+#ifdef BRAINLLM_JSON_SSE2
+        // Skip 16-byte blocks that hold neither a quote nor a backslash
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        while (pos + 16 <= size) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(json.data() + pos));
+            __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+            if (_mm_movemask_epi8(special) != 0) break;
+            pos += 16;
+        }
+#endif
+        while (pos < size && json[pos] != '"' && json[pos] != '\\') ++pos;
+        if (pos >= size) return std::string_view::npos;
+        if (json[pos] == '"') return pos;
+        pos += 2;  // Escape: skip the backslash and the escaped character
+    }
+    return std::string_view::npos;
+}
+
+bool is_valid_number(std::string_view text) {
+    if (text.empty()) return false;
+    
+    // from_chars accepts forms JSON does not (e.g. "inf", leading '+'), so
+    // check the first character before letting it validate the rest
+    char first = text[0];
+    if (first != '-' && (first < '0' || first > '9')) return false;
+    
+    // No leading zeros ("01", "-01")
+    size_t digits = (first == '-') ? 1 : 0;
+    if (text.size() > digits + 1 && text[digits] == '0' && text[digits + 1] >= '0' && text[digits + 1] <= '9') {
+        return false;
+    }
+    
+    double value = 0.0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool read_hex4(std::string_view text, size_t pos, uint32_t& code) {
+    if (pos + 4 > text.size()) return false;
+    code = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        int digit = hex_digit(text[pos + i]);
+        if (digit < 0) return false;
+        code = code * 16 + static_cast<uint32_t>(digit);
+    }
+    return true;
+}
+
+void append_utf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+enum class Expect {
+    Value,
+    ValueOrClose,   // Just after '['
+    Key,
+    KeyOrClose,     // Just after '{'
+    Colon,
+    CommaOrClose,
+    Done
+};
+
+} // namespace
+
+// ========================================
+// JSON READER
+// ========================================
+
+bool JsonReader::parse(std::string_view json) {
+    json_ = json;
+    offsets_.clear();
+    matching_.clear();
+    open_stack_.clear();
+    error_.clear();
+    
+    if (json.size() >= std::numeric_limits<uint32_t>::max()) {
+        return fail("document too large", 0);
+    }
+    
+    Expect expect = Expect::Value;
+    auto after_value = [this, &expect]() {
+        expect = open_stack_.empty() ? Expect::Done : Expect::CommaOrClose;
+    };
+    auto add_token = [this](size_t offset) {
+        offsets_.push_back(static_cast<uint32_t>(offset));
+        matching_.push_back(0);
+        return static_cast<uint32_t>(offsets_.size() - 1);
+    };
+    
+    size_t pos = 0;
+    while (pos < json.size()) {
+        char c = json[pos];
+        if (is_whitespace(c)) {
+            ++pos;
+            continue;
+        }
+        
+        switch (c) {
+            case '{':
+            case '[': {
+                if (expect != Expect::Value && expect != Expect::ValueOrClose) {
+                    return fail("unexpected container", pos);
+                }
+                open_stack_.push_back(add_token(pos));
+                expect = (c == '{') ? Expect::KeyOrClose : Expect::ValueOrClose;
+                ++pos;
+                break;
+            }
+            case '}':
+            case ']': {
+                char open = (c == '}') ? '{' : '[';
+                Expect empty_state = (c == '}') ? Expect::KeyOrClose : Expect::ValueOrClose;
+                if (open_stack_.empty() || token_char(open_stack_.back()) != open ||
+                    (expect != Expect::CommaOrClose && expect != empty_state)) {
+                    return fail("unbalanced brackets", pos);
+                }
+                uint32_t close = add_token(pos);
+                matching_[open_stack_.back()] = close;
+                open_stack_.pop_back();
+                after_value();
+                ++pos;
+                break;
+            }
+            case ':': {
+                if (expect != Expect::Colon) return fail("unexpected ':'", pos);
+                add_token(pos);
+                expect = Expect::Value;
+                ++pos;
+                break;
+            }
+            case ',': {
+                if (expect != Expect::CommaOrClose) return fail("unexpected ','", pos);
+                add_token(pos);
+                expect = (token_char(open_stack_.back()) == '{') ? Expect::Key : Expect::Value;
+                ++pos;
+                break;
+            }
+            case '"': {
+                bool is_key = (expect == Expect::Key || expect == Expect::KeyOrClose);
+                if (!is_key && expect != Expect::Value && expect != Expect::ValueOrClose) {
+                    return fail("unexpected string", pos);
+                }
+                size_t end = find_string_end(json, pos);
+                if (end == std::string_view::npos) return fail("unterminated string", pos);
+                add_token(pos);
+                if (is_key) {
+                    expect = Expect::Colon;
+                } else {
+                    after_value();
+                }
+                pos = end + 1;
+                break;
+            }
+            default: {
+                if (expect != Expect::Value && expect != Expect::ValueOrClose) {
+                    return fail("unexpected value", pos);
+                }
+                size_t end = pos;
+                while (end < json.size() && !is_delimiter(json[end])) ++end;
+                std::string_view literal = json.substr(pos, end - pos);
+                if (literal != "true" && literal != "false" && literal != "null" && !is_valid_number(literal)) {
+                    return fail("invalid literal", pos);
+                }
+                add_token(pos);
+                after_value();
+                pos = end;
+                break;
+            }
+        }
+    }
+    
+    if (expect != Expect::Done) {
+        return fail("unexpected end of document", json.size());
+    }
+    return true;
+}
+
+JsonValue JsonReader::root() const {
+    if (offsets_.empty()) return JsonValue();
+    return JsonValue(this, 0);
+}
+
+bool JsonReader::fail(const char* message, size_t offset) {
+    error_ = std::string(message) + " at offset " + std::to_string(offset);
+    offsets_.clear();
+    matching_.clear();
+    return false;
+}
+
+uint32_t JsonReader::skip(uint32_t token) const {
+    char c = token_char(token);
+    return (c == '{' || c == '[') ? matching_[token] + 1 : token + 1;
+}
+
+std::string_view JsonReader::scalar_text(uint32_t token) const {
+    size_t start = offsets_[token];
+    size_t end;
+    if (json_[start] == '"') {
+        end = find_string_end(json_, start) + 1;
+    } else {
+        end = start;
+        while (end < json_.size() && !is_delimiter(json_[end])) ++end;
+    }
+    return json_.substr(start, end - start);
+}
+
+bool JsonReader::unescape(std::string_view quoted, std::string& out) {
+    std::string_view body = quoted.substr(1, quoted.size() - 2);
+    out.clear();
+    out.reserve(body.size());
+    
+    size_t pos = 0;
+    while (pos < body.size()) {
+        size_t backslash = body.find('\\', pos);
+        if (backslash == std::string_view::npos) {
+            out.append(body.data() + pos, body.size() - pos);
+            break;
+        }
+        out.append(body.data() + pos, backslash - pos);
+        if (backslash + 1 >= body.size()) return false;
+        
+        char escaped = body[backslash + 1];
+        pos = backslash + 2;
+        switch (escaped) {
+            case '"':  out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/':  out += '/'; break;
+            case 'b':  out += '\b'; break;
+            case 'f':  out += '\f'; break;
+            case 'n':  out += '\n'; break;
+            case 'r':  out += '\r'; break;
+            case 't':  out += '\t'; break;
+            case 'u': {
+                uint32_t code = 0;
+                if (!read_hex4(body, pos, code)) return false;
+                pos += 4;
+                
+                // Combine UTF-16 surrogate pairs into one code point
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    uint32_t low = 0;
+                    if (pos + 6 > body.size() || body[pos] != '\\' || body[pos + 1] != 'u' ||
+                        !read_hex4(body, pos + 2, low) || low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                    return false;
+                }
+                append_utf8(out, code);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// ========================================
+// JSON VALUE
+// ========================================
+
+JsonValue::Type JsonValue::type() const {
+    if (!reader_ || token_ >= reader_->offsets_.size()) return Type::Invalid;
+    
+    switch (reader_->token_char(token_)) {
+        case '{': return Type::Object;
+        case '[': return Type::Array;
+        case '"': return Type::String;
+        case 't':
+        case 'f': return Type::Bool;
+        case 'n': return Type::Null;
+        default:  return Type::Number;
+    }
+}
+
+JsonValue JsonValue::operator[](std::string_view key) const {
+    if (!is_object()) return JsonValue();
+    
+    std::string decoded;
+    uint32_t token = token_ + 1;
+    while (reader_->token_char(token) != '}') {
+        std::string_view quoted = reader_->scalar_text(token);
+        std::string_view name = quoted.substr(1, quoted.size() - 2);
+        
+        bool matches;
+        if (name.find('\\') == std::string_view::npos) {
+            matches = (name == key);
+        } else {
+            matches = JsonReader::unescape(quoted, decoded) && decoded == key;
+        }
+        if (matches) return JsonValue(reader_, token + 2);
+        
+        token = reader_->skip(token + 2);
+        if (reader_->token_char(token) == ',') ++token;
+    }
+    return JsonValue();
+}
+
+size_t JsonValue::size() const {
+    Type kind = type();
+    if (kind != Type::Array && kind != Type::Object) return 0;
+    
+    char close = (kind == Type::Array) ? ']' : '}';
+    size_t count = 0;
+    uint32_t token = token_ + 1;
+    while (reader_->token_char(token) != close) {
+        if (kind == Type::Object) token += 2;  // Step over key and ':'
+        token = reader_->skip(token);
+        ++count;
+        if (reader_->token_char(token) == ',') ++token;
+    }
+    return count;
+}
+
+JsonValue JsonValue::at(size_t index) const {
+    Type kind = type();
+    if (kind != Type::Array && kind != Type::Object) return JsonValue();
+    
+    char close = (kind == Type::Array) ? ']' : '}';
+    uint32_t token = token_ + 1;
+    for (size_t i = 0; reader_->token_char(token) != close; ++i) {
+        if (kind == Type::Object) token += 2;
+        if (i == index) return JsonValue(reader_, token);
+        token = reader_->skip(token);
+        if (reader_->token_char(token) == ',') ++token;
+    }
+    return JsonValue();
+}
+
+JsonValue JsonValue::first() const {
+    if (!is_array() || reader_->token_char(token_ + 1) == ']') return JsonValue();
+    return JsonValue(reader_, token_ + 1);
+}
+
+JsonValue JsonValue::next() const {
+    if (!is_valid()) return JsonValue();
+    
+    uint32_t token = reader_->skip(token_);
+    if (token >= reader_->offsets_.size() || reader_->token_char(token) != ',') return JsonValue();
+    return JsonValue(reader_, token + 1);
+}
+
+std::string JsonValue::as_string(const std::string& fallback) const {
+    if (!is_string()) return fallback;
+    
+    std::string out;
+    return JsonReader::unescape(reader_->scalar_text(token_), out) ? out : fallback;
+}
+
+double JsonValue::as_double(double fallback) const {
+    if (!is_number()) return fallback;
+    
+    std::string_view text = reader_->scalar_text(token_);
+    double value = fallback;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() ? value : fallback;
+}
+
+int64_t JsonValue::as_int(int64_t fallback) const {
+    if (!is_number()) return fallback;
+    
+    std::string_view text = reader_->scalar_text(token_);
+    int64_t value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec == std::errc() && result.ptr == text.data() + text.size()) return value;
+    
+    // Fractions and exponents: truncate when the value fits
+    double real = as_double(static_cast<double>(fallback));
+    if (real >= -9.2e18 && real <= 9.2e18) return static_cast<int64_t>(real);
+    return fallback;
+}
+
+bool JsonValue::as_bool(bool fallback) const {
+    if (type() != Type::Bool) return fallback;
+    return reader_->token_char(token_) == 't';
+}
+
+std::string_view JsonValue::raw() const {
+    Type kind = type();
+    if (kind == Type::Invalid) return std::string_view();
+    if (kind == Type::Object || kind == Type::Array) {
+        size_t start = reader_->offsets_[token_];
+        size_t end = reader_->offsets_[reader_->matching_[token_]] + 1;
+        return reader_->json_.substr(start, end - start);
+    }
+    return reader_->scalar_text(token_);
+}
+
+} // namespace BrainLLM
@@ -0,0 +1,250 @@
+#include "json_writer.h"
+#include <array>
+#include <charconv>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BRAINLLM_JSON_SSE2 1
+#endif
+
+namespace BrainLLM {
+
+namespace {
+
+// Bytes that can be copied verbatim: printable ASCII other than '"' and '\'
+constexpr std::array<bool, 256> kPlainByte = [] {
+    std::array<bool, 256> table{};
+    for (int c = 0x20; c < 0x80; ++c) {
+        table[c] = (c != '"' && c != '\\');
+    }
+    return table;
+}();
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+// Length of the well-formed UTF-8 sequence starting at p, or 0 if invalid
+size_t utf8_sequence_length(const unsigned char* p, const unsigned char* end) {
+    auto continuation = [](unsigned char c) { return (c & 0xC0) == 0x80; };
+    size_t available = static_cast<size_t>(end - p);
+    unsigned char lead = p[0];
+    
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        return (available >= 2 && continuation(p[1])) ? 2 : 0;
+    }
+    if (lead >= 0xE0 && lead <= 0xEF) {
+        if (available < 3 || !continuation(p[1]) || !continuation(p[2])) return 0;
+        if (lead == 0xE0 && p[1] < 0xA0) return 0;  // Overlong
+        if (lead == 0xED && p[1] > 0x9F) return 0;  // Surrogate
+        return 3;
+    }
+    if (lead >= 0xF0 && lead <= 0xF4) {
+        if (available < 4 || !continuation(p[1]) || !continuation(p[2]) || !continuation(p[3])) return 0;
+        if (lead == 0xF0 && p[1] < 0x90) return 0;  // Overlong
+        if (lead == 0xF4 && p[1] > 0x8F) return 0;  // Above U+10FFFF
+        return 4;
+    }
+    return 0;
+}
+
+} // namespace
+
+JsonWriter::JsonWriter(std::string& out)
+    : out_(out), has_elements_(0), depth_(0), after_key_(false) {}
+
+JsonWriter& JsonWriter::begin_object() {
+    separator();
+    out_.push_back('{');
+    push();
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_object() {
+    pop();
+    out_.push_back('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::begin_array() {
+    separator();
+    out_.push_back('[');
+    push();
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_array() {
+    pop();
+    out_.push_back(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    separator();
+    append_escaped(out_, name);
+    out_.push_back(':');
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+    separator();
+    append_escaped(out_, text);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* text) {
+    return text ? value(std::string_view(text)) : null_value();
+}
+
+JsonWriter& JsonWriter::value(float number) {
+    separator();
+    append_number(out_, number);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    separator();
+    append_number(out_, number);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int number) {
+    return value(static_cast<int64_t>(number));
+}
+
+JsonWriter& JsonWriter::value(int64_t number) {
+    separator();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    out_.append(digits, result.ptr);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(uint64_t number) {
+    separator();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    out_.append(digits, result.ptr);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separator();
+    out_.append(flag ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::null_value() {
+    separator();
+    out_.append("null");
+    return *this;
+}
+
+void JsonWriter::append_escaped(std::string& out, std::string_view text) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char* end = p + text.size();
+    
+    out.push_back('"');
+    while (p < end) {
+        const unsigned char* run = p;
+
+#ifdef BRAINLLM_JSON_SSE2
+        // A signed compare against 0x20 flags both control characters and
+        // bytes >= 0x80, so one test covers everything that is not plain ASCII
+        const __m128i space = _mm_set1_epi8(0x20);
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i special = _mm_or_si128(
+                _mm_cmplt_epi8(chunk, space),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+            if (_mm_movemask_epi8(special) != 0) break;
+            p += 16;
+        }
+#endif
+        while (p < end && kPlainByte[*p]) ++p;
+        out.append(reinterpret_cast<const char*>(run), static_cast<size_t>(p - run));
+        if (p == end) break;
+        
+        unsigned char c = *p;
+        switch (c) {
+            case '"':  out.append("\\\""); ++p; continue;
+            case '\\': out.append("\\\\"); ++p; continue;
+            case '\n': out.append("\\n"); ++p; continue;
+            case '\r': out.append("\\r"); ++p; continue;
+            case '\t': out.append("\\t"); ++p; continue;
+            case '\b': out.append("\\b"); ++p; continue;
+            case '\f': out.append("\\f"); ++p; continue;
+            default: break;
+        }
+        
+        if (c < 0x20) {
+            const char escape[6] = {'\\', 'u', '0', '0', kHexDigits[c >> 4], kHexDigits[c & 0xF]};
+            out.append(escape, sizeof(escape));
+            ++p;
+            continue;
+        }
+        
+        size_t length = utf8_sequence_length(p, end);
+        if (length == 0) {
+            out.append("\\ufffd");
+            ++p;
+        } else {
+            out.append(reinterpret_cast<const char*>(p), length);
+            p += length;
+        }
+    }
+    out.push_back('"');
+}
+
+void JsonWriter::append_number(std::string& out, double number) {
+    if (!std::isfinite(number)) {
+        out.append("null");  // JSON has no NaN or Infinity
+        return;
+    }
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    out.append(digits, result.ptr);
+}
+
+void JsonWriter::append_number(std::string& out, float number) {
+    if (!std::isfinite(number)) {
+        out.append("null");
+        return;
+    }
+    // Float overload keeps 0.87f as "0.87" rather than its double expansion
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    out.append(digits, result.ptr);
+}
+
+void JsonWriter::separator() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (depth_ == 0) return;
+    
+    uint64_t bit = 1ULL << (depth_ - 1);
+    if (has_elements_ & bit) {
+        out_.push_back(',');
+    } else {
+        has_elements_ |= bit;
+    }
+}
+
+void JsonWriter::push() {
+    if (depth_ < kMaxDepth) {
+        ++depth_;
+        has_elements_ &= ~(1ULL << (depth_ - 1));
+    }
+}
+
+void JsonWriter::pop() {
+    if (depth_ > 0) {
+        --depth_;
+    }
+}
+
+} // namespace BrainLLM
@@ -1,128 +1,660 @@
 #include "request_handler.h"
-#include <sstream>
+#include "trace.h"
+#include <algorithm>
+#include <limits>
 
 namespace BrainLLM {
 
+namespace {
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+std::string url_decode(std::string_view text) {
+    std::string decoded;
+    decoded.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '+') {
+            decoded += ' ';
+        } else if (text[i] == '%' && i + 2 < text.size() &&
+                   hex_value(text[i + 1]) >= 0 && hex_value(text[i + 2]) >= 0) {
+            decoded += static_cast<char>(hex_value(text[i + 1]) * 16 + hex_value(text[i + 2]));
+            i += 2;
+        } else {
+            decoded += text[i];
+        }
+    }
+    return decoded;
+}
+
+std::string_view trim_whitespace(std::string_view text) {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) return std::string_view();
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+} // namespace
+
+std::string ApiRequest::query_param(std::string_view name) const {
+    std::string_view remaining = query;
+    while (!remaining.empty()) {
+        size_t amp = remaining.find('&');
+        std::string_view pair = remaining.substr(0, amp);
+        remaining = (amp == std::string_view::npos) ? std::string_view() : remaining.substr(amp + 1);
+        
+        size_t eq = pair.find('=');
+        if (pair.substr(0, eq) == name) {
+            return eq == std::string_view::npos ? std::string() : url_decode(pair.substr(eq + 1));
+        }
+    }
+    return std::string();
+}
+
 RequestHandler::RequestHandler(std::shared_ptr<LLMEngine> engine)
-    : engine_(engine) {}
+    : engine_(engine), response_cache_(kResponseCacheEntries) {
+    if (engine_) {
+        auto config = engine_->get_config();
+        size_t batch_size = static_cast<size_t>(std::max(1, config.batch_size));
+        scheduler_ = std::make_unique<DecodeScheduler>(
+            engine_, batch_size, batch_size * static_cast<size_t>(std::max(1, config.context_length)));
+        scheduler_->start();
+    }
+    
+    add_route("POST", "/api/process", &RequestHandler::handle_process);
+    add_route("POST", "/api/process_batch", &RequestHandler::handle_process_batch);
+    add_route("POST", "/api/generate", &RequestHandler::handle_generate);
+    add_route("GET", "/api/status", &RequestHandler::handle_status);
+    add_route("GET", "/api/memory", &RequestHandler::handle_memory);
+    add_route("GET", "/api/memory/category/{category}", &RequestHandler::handle_memory_category);
+    add_route("GET", "/api/config", &RequestHandler::handle_config);
+    add_route("GET", "/api/session/{id}", &RequestHandler::handle_session);
+    add_route("DELETE", "/api/session/{id}", &RequestHandler::handle_session_close);
+    add_route("POST", "/api/train", &RequestHandler::handle_train);
+    add_route("GET", "/metrics", &RequestHandler::handle_metrics, "text/plain; version=0.0.4");
+    add_route("GET", "/debug/trace", &RequestHandler::handle_trace_dump);
+    add_route("POST", "/debug/trace", &RequestHandler::handle_trace_control);
+}
 
-QString RequestHandler::handle_request(const QString& method, const QString& path, const QString& body) {
-    if (path == "/api/process" && method == "POST") {
-        return handle_process(body);
+ApiResponse RequestHandler::handle_request(const HttpRequest& http_request, std::string buffer) {
+    std::string_view target = http_request.path;
+    size_t query_start = target.find('?');
+    
+    ApiRequest request{http_request.method, target.substr(0, query_start), std::string_view(),
+                       http_request.body, std::string_view(), std::string_view(), {}, 0};
+    if (query_start != std::string_view::npos) {
+        request.query = target.substr(query_start + 1);
     }
-    else if (path == "/api/generate" && method == "POST") {
-        return handle_generate(body);
+    auto content_type = http_request.headers.find("content-type");
+    if (content_type != http_request.headers.end()) {
+        request.content_type = content_type->second;
     }
-    else if (path == "/api/status" && method == "GET") {
-        return handle_status(body);
+    auto session_id = http_request.headers.find("x-session-id");
+    if (session_id != http_request.headers.end()) {
+        request.session_id = session_id->second;
     }
-    else if (path == "/api/memory" && method == "GET") {
-        return handle_memory(body);
+    
+    BRAINLLM_TRACE_SCOPE("http", "RequestHandler::handle_request");
+    RuntimeMetrics& metrics = runtime_metrics();
+    ScopedTimer timer(metrics.request_duration);
+    
+    // Serialize straight into the recycled buffer; its capacity carries over
+    buffer.clear();
+    JsonWriter json(buffer);
+    
+    bool path_matched = false;
+    int status_code;
+    const char* response_type = "application/json";
+    const Route* route = find_route(request.method, request.path, request, path_matched);
+    if (!route) {
+        status_code = path_matched ? write_error(json, "Method not allowed", 405)
+                                   : write_error(json, "Endpoint not found", 404);
+    } else {
+        status_code = (this->*route->handler)(request, json);
+        if (status_code < 400) {
+            response_type = route->content_type;
+        }
+    }
+    
+    if (status_code >= 500) {
+        metrics.requests_server_error.add();
+    } else if (status_code >= 400) {
+        metrics.requests_client_error.add();
+    } else {
+        metrics.requests_ok.add();
     }
-    else if (path == "/api/config" && method == "GET") {
-        return handle_config(body);
+    
+    return ApiResponse{status_code, std::move(buffer), response_type};
+}
+
+void RequestHandler::add_route(const std::string& method, const std::string& pattern, RouteHandler handler,
+                               const char* content_type) {
+    Route route{method, pattern, {}, handler, content_type};
+    
+    size_t start = 1;
+    while (start <= pattern.size()) {
+        size_t end = pattern.find('/', start);
+        if (end == std::string::npos) end = pattern.size();
+        route.segments.push_back(pattern.substr(start, end - start));
+        start = end + 1;
+    }
+    
+    bool has_params = pattern.find('{') != std::string::npos;
+    routes_.push_back(std::move(route));
+    
+    if (has_params) {
+        pattern_routes_.push_back(routes_.size() - 1);
+    } else {
+        exact_routes_[route_hash(method, pattern)] = routes_.size() - 1;
+    }
+}
+
+const RequestHandler::Route* RequestHandler::find_route(std::string_view method, std::string_view path,
+                                                        ApiRequest& request, bool& path_matched) const {
+    auto exact = exact_routes_.find(route_hash(method, path));
+    if (exact != exact_routes_.end()) {
+        const Route& route = routes_[exact->second];
+        if (route.method == method && route.pattern == path) return &route;
     }
-    else if (path == "/api/train" && method == "POST") {
-        return handle_train(body);
+    
+    for (size_t index : pattern_routes_) {
+        const Route& route = routes_[index];
+        if (!match_pattern(route, path, request)) continue;
+        if (route.method == method) return &route;
+        path_matched = true;
+    }
+    
+    // Distinguish a wrong method on a known path (405) from an unknown path (404)
+    for (const Route& route : routes_) {
+        if (route.pattern == path) {
+            path_matched = true;
+            break;
+        }
+    }
+    
+    return nullptr;
+}
+
+bool RequestHandler::match_pattern(const Route& route, std::string_view path, ApiRequest& request) {
+    if (path.empty() || path[0] != '/') return false;
+    
+    size_t param_count = 0;
+    size_t start = 1;
+    for (const std::string& segment : route.segments) {
+        if (start > path.size()) return false;
+        
+        size_t end = path.find('/', start);
+        if (end == std::string_view::npos) end = path.size();
+        std::string_view part = path.substr(start, end - start);
+        
+        if (!segment.empty() && segment.front() == '{') {
+            if (part.empty() || param_count == ApiRequest::kMaxParams) return false;
+            request.params[param_count++] = part;
+        } else if (part != segment) {
+            return false;
+        }
+        start = end + 1;
+    }
+    
+    if (start <= path.size()) return false;  // Path has extra segments
+    
+    request.param_count = param_count;
+    return true;
+}
+
+uint64_t RequestHandler::route_hash(std::string_view method, std::string_view path) {
+    // FNV-1a over "METHOD path"
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](std::string_view text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+    };
+    mix(method);
+    mix(" ");
+    mix(path);
+    return hash;
+}
+
+RequestHandler::BodyFormat RequestHandler::parse_body(const ApiRequest& request, JsonReader& reader) {
+    bool declared_json = request.content_type.find("application/json") != std::string_view::npos;
+    
+    size_t first = request.body.find_first_not_of(" \t\r\n");
+    bool looks_like_json = first != std::string::npos && request.body[first] == '{';
+    if (!declared_json && !looks_like_json) return BodyFormat::Text;
+    
+    if (reader.parse(request.body) && reader.root().is_object()) return BodyFormat::Json;
+    
+    // Undeclared text that merely starts with '{' stays plain text
+    return declared_json ? BodyFormat::Invalid : BodyFormat::Text;
+}
+
+int RequestHandler::handle_process(const ApiRequest& request, JsonWriter& json) {
+    if (!engine_) {
+        return write_error(json, "Engine not initialized", 503);
+    }
+    
+    thread_local JsonReader reader;
+    std::string decoded;
+    const std::string* input = &request.body;
+    JsonValue body;
+    
+    switch (parse_body(request, reader)) {
+        case BodyFormat::Invalid:
+            return write_error(json, "Malformed JSON body: " + reader.error());
+        case BodyFormat::Json:
+            body = reader.root();
+            if (!body["input"].is_string()) {
+                return write_error(json, "Missing string field 'input'");
+            }
+            decoded = body["input"].as_string();
+            input = &decoded;
+            break;
+        case BodyFormat::Text:
+            break;
+    }
+    
+    // Surrounding whitespace carries no meaning, so the engine and the cache
+    // key both see the trimmed, decoded text; a plain-text body with a
+    // trailing newline and its JSON equivalent share one entry
+    std::string_view trimmed = trim_whitespace(*input);
+    if (trimmed.size() != input->size()) {
+        decoded = std::string(trimmed);
+        input = &decoded;
+    }
+    
+    std::string session_id;
+    if (!read_session_id(request, body, session_id)) {
+        return write_error(json, "Invalid session id");
+    }
+    
+    // A session request must reach the engine to update its session, so
+    // only anonymous requests use the cache. The version is read before
+    // computing so a concurrent train cannot leave a stale reply under the
+    // new version.
+    std::string_view key = *input;
+    uint64_t version = engine_->get_model_version();
+    bool cacheable = session_id.empty();
+    if (cacheable && response_cache_.lookup(ResponseCache::Endpoint::Process, key, version, json.buffer())) {
+        return 200;
     }
     
-    return create_error_response("Endpoint not found");
+    std::string output = engine_->process_input(*input, session_id);
+    
+    int status_code = write_message(json, output);
+    if (cacheable) {
+        response_cache_.insert(ResponseCache::Endpoint::Process, key, version, json.buffer());
+    }
+    return status_code;
 }
 
-QString RequestHandler::handle_process(const QString& body) {
+int RequestHandler::handle_process_batch(const ApiRequest& request, JsonWriter& json) {
     if (!engine_) {
-        return create_error_response("Engine not initialized");
+        return write_error(json, "Engine not initialized", 503);
+    }
+    
+    thread_local JsonReader reader;
+    if (parse_body(request, reader) != BodyFormat::Json) {
+        return write_error(json, "Expected a JSON body with an 'inputs' array");
+    }
+    
+    JsonValue inputs_value = reader.root()["inputs"];
+    if (!inputs_value.is_array()) {
+        return write_error(json, "Missing array field 'inputs'");
+    }
+    std::string session_id;
+    if (!read_session_id(request, reader.root(), session_id)) {
+        return write_error(json, "Invalid session id");
+    }
+    
+    std::vector<std::string> inputs;
+    for (JsonValue input = inputs_value.first(); input.is_valid(); input = input.next()) {
+        if (!input.is_string()) {
+            return write_error(json, "Field 'inputs' must contain only strings");
+        }
+        if (inputs.size() == kMaxBatchInputs) {
+            return write_error(json, "At most " + std::to_string(kMaxBatchInputs) + " inputs per batch");
+        }
+        inputs.push_back(input.as_string());
     }
     
-    std::string input = body.toStdString();
-    std::string output = engine_->process_input(input);
+    // The whole array goes through the engine as one batched forward pass
+    auto outputs = engine_->process_batch(inputs, session_id);
+    
+    json.begin_object().key("outputs").begin_array();
+    for (const auto& output : outputs) {
+        json.value(std::string_view(output));
+    }
+    json.end_array().end_object();
     
-    return create_json_response(output);
+    return 200;
 }
 
-QString RequestHandler::handle_generate(const QString& body) {
+int RequestHandler::handle_generate(const ApiRequest& request, JsonWriter& json) {
     if (!engine_) {
-        return create_error_response("Engine not initialized");
+        return write_error(json, "Engine not initialized", 503);
+    }
+    
+    thread_local JsonReader reader;
+    std::string decoded;
+    const std::string* prompt = &request.body;
+    GenerationOptions options;
+    JsonValue body;
+    
+    switch (parse_body(request, reader)) {
+        case BodyFormat::Invalid:
+            return write_error(json, "Malformed JSON body: " + reader.error());
+        case BodyFormat::Json: {
+            body = reader.root();
+            if (!body["prompt"].is_string()) {
+                return write_error(json, "Missing string field 'prompt'");
+            }
+            decoded = body["prompt"].as_string();
+            prompt = &decoded;
+            
+            // Range-check the 64-bit value; narrowing first would wrap
+            // out-of-range inputs into accepted ones
+            int64_t max_tokens = body["max_tokens"].as_int(options.max_tokens);
+            if (max_tokens < 1 || max_tokens > kMaxGenerationTokens) {
+                return write_error(json, "max_tokens must be between 1 and " + std::to_string(kMaxGenerationTokens));
+            }
+            options.max_tokens = static_cast<int>(max_tokens);
+            if (body["temperature"].is_valid()) {
+                options.temperature = static_cast<float>(body["temperature"].as_double(-1.0));
+                if (options.temperature < 0.0f) {
+                    return write_error(json, "temperature must be a non-negative number");
+                }
+            }
+            int64_t top_k = body["top_k"].as_int(options.top_k);
+            if (top_k < 0 || top_k > std::numeric_limits<int>::max()) {
+                return write_error(json, "top_k must be between 0 and " +
+                                          std::to_string(std::numeric_limits<int>::max()));
+            }
+            options.top_k = static_cast<int>(top_k);
+            options.top_p = static_cast<float>(body["top_p"].as_double(options.top_p));
+            if (!(options.top_p > 0.0f && options.top_p <= 1.0f)) {
+                return write_error(json, "top_p must be in (0, 1]");
+            }
+            options.repetition_penalty = static_cast<float>(
+                body["repetition_penalty"].as_double(options.repetition_penalty));
+            if (!(options.repetition_penalty > 0.0f)) {
+                return write_error(json, "repetition_penalty must be positive");
+            }
+            int64_t seed = body["seed"].as_int(0);
+            if (seed < 0) {
+                return write_error(json, "seed must be a non-negative integer");
+            }
+            options.seed = static_cast<uint64_t>(seed);
+            break;
+        }
+        case BodyFormat::Text:
+            break;
+    }
+    
+    if (!read_session_id(request, body, options.session_id)) {
+        return write_error(json, "Invalid session id");
     }
     
-    std::string prompt = body.toStdString();
-    std::string response = engine_->generate_response(prompt);
+    std::string response = scheduler_->generate(*prompt, options);
     
-    return create_json_response(response);
+    return write_message(json, response);
 }
 
-QString RequestHandler::handle_status(const QString& body) {
+int RequestHandler::handle_status(const ApiRequest& /*request*/, JsonWriter& json) {
     if (!engine_) {
-        return create_error_response("Engine not initialized");
+        return write_error(json, "Engine not initialized", 503);
     }
     
     auto metrics = engine_->get_metrics();
+    auto latency = runtime_metrics().request_duration.snapshot();
+    auto cache = response_cache_.get_stats();
+    auto prefixes = engine_->get_prefix_cache_stats();
+    auto sessions = engine_->get_session_stats();
+    uint64_t accepted = runtime_metrics().speculative_accepted.value();
+    uint64_t proposed = accepted + runtime_metrics().speculative_rejected.value();
     
-    std::ostringstream oss;
-    oss << "{\"status\":\"running\",\"confidence\":" << engine_->get_confidence() 
-        << ",\"accuracy\":" << metrics.accuracy << "}";
+    json.begin_object()
+        .field("status", "running")
+        .field("confidence", engine_->get_confidence())
+        .field("accuracy", metrics.accuracy)
+        .field("cpu_usage", metrics.cpu_usage)
+        .field("memory_usage", metrics.memory_usage)
+        .field("tokens_per_second", metrics.processing_speed)
+        .field("tokens_processed", metrics.tokens_processed)
+        .field("request_p50_ms", latency.percentile(0.50) / 1e6)
+        .field("request_p99_ms", latency.percentile(0.99) / 1e6)
+        .field("cache_hits", cache.hits)
+        .field("cache_misses", cache.misses)
+        .field("cache_entries", static_cast<uint64_t>(cache.entries))
+        .field("prefix_cache_hits", prefixes.hits)
+        .field("prefix_cache_bytes", static_cast<uint64_t>(prefixes.bytes))
+        .field("speculative_acceptance_rate", proposed == 0 ? 0.0 : static_cast<double>(accepted) / proposed)
+        .field("sessions_active", static_cast<uint64_t>(sessions.active))
+        .end_object();
     
-    return QString::fromStdString(oss.str());
+    return 200;
 }
 
-QString RequestHandler::handle_memory(const QString& body) {
+int RequestHandler::handle_memory(const ApiRequest& request, JsonWriter& json) {
     if (!engine_) {
-        return create_error_response("Engine not initialized");
+        return write_error(json, "Engine not initialized", 503);
     }
     
-    std::string query = body.toStdString();
-    auto memories = engine_->recall_memories(query);
+    // Query comes from ?query=... when present, otherwise from the body
+    std::string query = request.query_param("query");
+    int count = 5;
     
-    std::ostringstream oss;
-    oss << "{\"memories\":[";
-    for (size_t i = 0; i < memories.size(); ++i) {
-        if (i > 0) oss << ",";
-        oss << "{\"content\":\"" << memories[i].content << "\",\"importance\":" 
-            << memories[i].importance << "}";
+    if (query.empty()) {
+        thread_local JsonReader reader;
+        switch (parse_body(request, reader)) {
+            case BodyFormat::Invalid:
+                return write_error(json, "Malformed JSON body: " + reader.error());
+            case BodyFormat::Json: {
+                query = reader.root()["query"].as_string();
+                int64_t requested = reader.root()["count"].as_int(count);
+                if (requested < 1 || requested > kMaxMemoryResults) {
+                    return write_error(json, "count must be between 1 and " + std::to_string(kMaxMemoryResults));
+                }
+                count = static_cast<int>(requested);
+                break;
+            }
+            case BodyFormat::Text:
+                query = request.body;
+                break;
+        }
     }
-    oss << "]}";
     
-    return QString::fromStdString(oss.str());
+    std::string key = std::to_string(count) + ':' + query;
+    uint64_t version = engine_->get_memory_version();
+    if (response_cache_.lookup(ResponseCache::Endpoint::Memory, key, version, json.buffer())) {
+        return 200;
+    }
+    
+    auto memories = engine_->recall_memories(query, count);
+    
+    int status_code = write_memories(json, memories);
+    response_cache_.insert(ResponseCache::Endpoint::Memory, key, version, json.buffer());
+    return status_code;
 }
 
-QString RequestHandler::handle_config(const QString& body) {
+int RequestHandler::handle_memory_category(const ApiRequest& request, JsonWriter& json) {
     if (!engine_) {
-        return create_error_response("Engine not initialized");
+        return write_error(json, "Engine not initialized", 503);
+    }
+    
+    auto memories = engine_->recall_memories_by_category(url_decode(request.params[0]));
+    
+    return write_memories(json, memories);
+}
+
+int RequestHandler::handle_config(const ApiRequest& /*request*/, JsonWriter& json) {
+    if (!engine_) {
+        return write_error(json, "Engine not initialized", 503);
     }
     
     auto config = engine_->get_config();
     
-    std::ostringstream oss;
-    oss << "{\"num_layers\":" << config.num_layers 
-        << ",\"neurons_per_layer\":" << config.neurons_per_layer 
-        << ",\"learning_rate\":" << config.learning_rate << "}";
+    json.begin_object()
+        .field("num_layers", config.num_layers)
+        .field("neurons_per_layer", config.neurons_per_layer)
+        .field("learning_rate", config.learning_rate)
+        .field("speculative_tokens", config.speculative_tokens)
+        .field("draft_layers", config.draft_layers)
+        .field("activation_checkpoint_interval", config.activation_checkpoint_interval)
+        .field("weight_precision", storage_name(config.weight_precision))
+        .end_object();
     
-    return QString::fromStdString(oss.str());
+    return 200;
 }
 
-QString RequestHandler::handle_train(const QString& body) {
+int RequestHandler::handle_session(const ApiRequest& request, JsonWriter& json) {
     if (!engine_) {
-        return create_error_response("Engine not initialized");
+        return write_error(json, "Engine not initialized", 503);
+    }
+    
+    std::string session_id = url_decode(request.params[0]);
+    std::vector<DialogueTurn> history;
+    if (!engine_->get_session_history(session_id, history)) {
+        return write_error(json, "Session not found", 404);
     }
     
+    json.begin_object()
+        .field("session_id", std::string_view(session_id))
+        .field("confidence", engine_->get_confidence(session_id))
+        .key("history").begin_array();
+    for (const auto& turn : history) {
+        json.begin_object()
+            .field("input", std::string_view(turn.input))
+            .field("output", std::string_view(turn.output))
+            .end_object();
+    }
+    json.end_array().end_object();
+    
+    return 200;
+}
+
+int RequestHandler::handle_session_close(const ApiRequest& request, JsonWriter& json) {
+    if (!engine_) {
+        return write_error(json, "Engine not initialized", 503);
+    }
+    
+    if (!engine_->close_session(url_decode(request.params[0]))) {
+        return write_error(json, "Session not found", 404);
+    }
+    return write_message(json, "Session closed");
+}
+
+int RequestHandler::handle_train(const ApiRequest& request, JsonWriter& json) {
+    if (!engine_) {
+        return write_error(json, "Engine not initialized", 503);
+    }
+    
+    thread_local JsonReader reader;
     std::vector<std::string> training_data;
-    training_data.push_back(body.toStdString());
+    
+    // "data" may be a single sample or an array of samples
+    switch (parse_body(request, reader)) {
+        case BodyFormat::Invalid:
+            return write_error(json, "Malformed JSON body: " + reader.error());
+        case BodyFormat::Json: {
+            JsonValue data = reader.root()["data"];
+            if (data.is_string()) {
+                training_data.push_back(data.as_string());
+            } else if (data.is_array()) {
+                for (JsonValue sample = data.first(); sample.is_valid(); sample = sample.next()) {
+                    if (!sample.is_string()) {
+                        return write_error(json, "Field 'data' must contain only strings");
+                    }
+                    training_data.push_back(sample.as_string());
+                }
+            } else {
+                return write_error(json, "Missing field 'data' (string or array of strings)");
+            }
+            break;
+        }
+        case BodyFormat::Text:
+            training_data.push_back(request.body);
+            break;
+    }
     
     engine_->train(training_data);
+    // Old entries are already unreachable; drop them to free the space
+    response_cache_.clear();
+    
+    return write_message(json, "Training completed");
+}
+
+int RequestHandler::handle_metrics(const ApiRequest& /*request*/, JsonWriter& json) {
+    // Prometheus text exposition goes straight into the response buffer
+    runtime_metrics().registry.write_prometheus(json.buffer());
+    return 200;
+}
+
+int RequestHandler::handle_trace_dump(const ApiRequest& /*request*/, JsonWriter& json) {
+    // Chrome trace-event JSON; load it in chrome://tracing or ui.perfetto.dev
+    json.buffer() += Tracer::instance().chrome_trace_json();
+    return 200;
+}
+
+int RequestHandler::handle_trace_control(const ApiRequest& request, JsonWriter& json) {
+    thread_local JsonReader reader;
+    if (parse_body(request, reader) != BodyFormat::Json) {
+        return write_error(json, "Expected a JSON body such as {\"enabled\": true, \"clear\": true}");
+    }
     
-    return create_json_response("Training completed");
+    Tracer& tracer = Tracer::instance();
+    JsonValue body = reader.root();
+    if (body["clear"].as_bool(false)) {
+        tracer.clear();
+    }
+    if (body["enabled"].is_valid()) {
+        tracer.set_enabled(body["enabled"].as_bool(false));
+    }
+    
+    json.begin_object().field("tracing", tracer.is_enabled()).end_object();
+    return 200;
 }
 
-QString RequestHandler::create_json_response(const std::string& message) {
-    std::ostringstream oss;
-    oss << "{\"message\":\"" << message << "\"}";
-    return QString::fromStdString(oss.str());
+bool RequestHandler::read_session_id(const ApiRequest& request, JsonValue body, std::string& session_id) {
+    if (!request.session_id.empty()) {
+        session_id.assign(request.session_id);
+    } else if (body["session_id"].is_valid()) {
+        if (!body["session_id"].is_string()) return false;
+        session_id = body["session_id"].as_string();
+    }
+    
+    // Ids are opaque to the server but must be short printable tokens
+    if (session_id.size() > kMaxSessionIdLength) return false;
+    return std::all_of(session_id.begin(), session_id.end(),
+                       [](unsigned char c) { return c > 0x20 && c < 0x7f; });
+}
+
+int RequestHandler::write_message(JsonWriter& json, std::string_view message) {
+    json.begin_object().field("message", message).end_object();
+    return 200;
 }
 
-QString RequestHandler::create_error_response(const std::string& error) {
-    std::ostringstream oss;
-    oss << "{\"error\":\"" << error << "\"}";
-    return QString::fromStdString(oss.str());
+int RequestHandler::write_error(JsonWriter& json, std::string_view error, int status_code) {
+    json.begin_object().field("error", error).end_object();
+    return status_code;
+}
+
+int RequestHandler::write_memories(JsonWriter& json, const std::vector<MemoryRecord>& memories) {
+    json.begin_object().key("memories").begin_array();
+    for (const auto& memory : memories) {
+        json.begin_object()
+            .field("content", std::string_view(memory.content))
+            .field("importance", memory.importance)
+            .end_object();
+    }
+    json.end_array().end_object();
+    
+    return 200;
 }
 
 } // namespace BrainLLM
@@ -0,0 +1,173 @@
+#include "response_cache.h"
+#include "metrics.h"
+#include <algorithm>
+
+namespace BrainLLM {
+
+namespace {
+
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+size_t next_power_of_two(size_t value) {
+    size_t power = 1;
+    while (power < value) power <<= 1;
+    return power;
+}
+
+} // namespace
+
+ResponseCache::FrequencySketch::FrequencySketch(size_t capacity)
+    : counters_(kDepth * next_power_of_two(std::max<size_t>(16, capacity * 4)), 0),
+      mask_(counters_.size() / kDepth - 1),
+      additions_(0),
+      sample_size_(std::max<size_t>(16, capacity * 10)) {}
+
+size_t ResponseCache::FrequencySketch::slot(uint64_t hash, int row) const {
+    // Each row remixes the hash with its own constant
+    uint64_t h = mix64(hash + 0x9e3779b97f4a7c15ULL * static_cast<uint64_t>(row + 1));
+    return static_cast<size_t>(row) * (mask_ + 1) + static_cast<size_t>(h & mask_);
+}
+
+void ResponseCache::FrequencySketch::increment(uint64_t hash) {
+    for (int row = 0; row < kDepth; ++row) {
+        uint8_t& counter = counters_[slot(hash, row)];
+        if (counter < 15) ++counter;
+    }
+    
+    if (++additions_ >= sample_size_) {
+        for (uint8_t& counter : counters_) {
+            counter >>= 1;
+        }
+        additions_ /= 2;
+    }
+}
+
+uint8_t ResponseCache::FrequencySketch::estimate(uint64_t hash) const {
+    uint8_t minimum = 15;
+    for (int row = 0; row < kDepth; ++row) {
+        minimum = std::min(minimum, counters_[slot(hash, row)]);
+    }
+    return minimum;
+}
+
+void ResponseCache::FrequencySketch::clear() {
+    std::fill(counters_.begin(), counters_.end(), 0);
+    additions_ = 0;
+}
+
+ResponseCache::ResponseCache(size_t max_entries)
+    : shard_capacity_(std::max<size_t>(1, (max_entries + kShards - 1) / kShards)) {
+    shards_.reserve(kShards);
+    for (size_t i = 0; i < kShards; ++i) {
+        shards_.push_back(std::make_unique<Shard>(shard_capacity_));
+    }
+}
+
+uint64_t ResponseCache::hash_key(Endpoint endpoint, std::string_view key, uint64_t version) {
+    // FNV-1a over the key, then folded with endpoint and version
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return mix64(hash ^ mix64(version * 4 + static_cast<uint64_t>(endpoint)));
+}
+
+bool ResponseCache::lookup(Endpoint endpoint, std::string_view key, uint64_t version, std::string& out) {
+    uint64_t hash = hash_key(endpoint, key, version);
+    Shard& shard = *shards_[hash % kShards];
+    RuntimeMetrics& metrics = runtime_metrics();
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.sketch.increment(hash);
+    
+    auto found = shard.index.find(hash);
+    if (found == shard.index.end() || found->second->endpoint != endpoint ||
+        found->second->version != version || found->second->key != key) {
+        ++shard.misses;
+        metrics.response_cache_misses.add();
+        return false;
+    }
+    
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    out += found->second->body;
+    ++shard.hits;
+    metrics.response_cache_hits.add();
+    return true;
+}
+
+void ResponseCache::insert(Endpoint endpoint, std::string_view key, uint64_t version, std::string_view body) {
+    if (body.size() > kMaxBodyBytes) return;
+    
+    uint64_t hash = hash_key(endpoint, key, version);
+    Shard& shard = *shards_[hash % kShards];
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(hash);
+    if (found != shard.index.end()) {
+        // Same key computed twice concurrently, or a hash collision: replace
+        Entry& entry = *found->second;
+        entry.endpoint = endpoint;
+        entry.version = version;
+        entry.key.assign(key);
+        entry.body.assign(body);
+        shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+        return;
+    }
+    
+    if (shard.lru.size() >= shard_capacity_) {
+        // Entries from an older version of the same endpoint can never hit
+        // again, so they go regardless of how popular they once were
+        const Entry& victim = shard.lru.back();
+        bool stale = victim.endpoint == endpoint && victim.version < version;
+        if (!stale && shard.sketch.estimate(hash) <= shard.sketch.estimate(victim.hash)) {
+            ++shard.rejections;
+            return;
+        }
+        evict_back(shard);
+    }
+    
+    shard.lru.push_front(Entry{hash, endpoint, version, std::string(key), std::string(body)});
+    shard.index.emplace(hash, shard.lru.begin());
+    runtime_metrics().response_cache_entries.add(1);
+}
+
+void ResponseCache::evict_back(Shard& shard) {
+    shard.index.erase(shard.lru.back().hash);
+    shard.lru.pop_back();
+    ++shard.evictions;
+    runtime_metrics().response_cache_evictions.add();
+    runtime_metrics().response_cache_entries.add(-1);
+}
+
+void ResponseCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        runtime_metrics().response_cache_entries.add(-static_cast<int64_t>(shard->lru.size()));
+        shard->lru.clear();
+        shard->index.clear();
+        shard->sketch.clear();
+    }
+}
+
+ResponseCache::Stats ResponseCache::get_stats() const {
+    Stats stats;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        stats.hits += shard->hits;
+        stats.misses += shard->misses;
+        stats.evictions += shard->evictions;
+        stats.rejections += shard->rejections;
+        stats.entries += shard->lru.size();
+    }
+    return stats;
+}
+
+} // namespace BrainLLM
@@ -1,11 +1,17 @@
 #include "rest_server.h"
+#include "trace.h"
 #include <QTcpSocket>
+#include <QThread>
+#include <QMetaObject>
+#include <algorithm>
 
 namespace BrainLLM {
 
 RestServer::RestServer(int port)
-    : tcp_server_(new QTcpServer(this)), port_(port), engine_(nullptr) {
+    : tcp_server_(new QTcpServer(this)), worker_pool_(new QThreadPool(this)),
+      port_(port), engine_(nullptr), next_connection_id_(1) {
     connect(tcp_server_, &QTcpServer::newConnection, this, &RestServer::on_new_connection);
+    set_api_settings(ConfigManager::default_api_settings());
 }
 
 RestServer::~RestServer() {
@@ -18,6 +24,8 @@ bool RestServer::start() {
 
 void RestServer::stop() {
     tcp_server_->close();
+    // Results still in flight are posted to this object and dropped if it is gone
+    worker_pool_->waitForDone();
 }
 
 bool RestServer::is_running() const {
@@ -26,11 +34,43 @@ bool RestServer::is_running() const {
 
 void RestServer::set_llm_engine(std::shared_ptr<LLMEngine> engine) {
     engine_ = engine;
+    handler_ = std::make_shared<RequestHandler>(engine);
+}
+
+void RestServer::set_api_settings(const ConfigManager::APISettings& settings) {
+    // More workers than cores only adds contention on the engine
+    int workers = std::max(1, std::min(settings.max_connections, QThread::idealThreadCount()));
+    worker_pool_->setMaxThreadCount(workers);
+    
+    AdmissionPolicy policy;
+    policy.max_connections = settings.max_connections;
+    policy.api_key = settings.api_key;
+    policy.requests_per_second = settings.requests_per_second;
+    policy.burst = settings.burst;
+    policy.max_queued_requests = static_cast<size_t>(std::max(0, settings.max_queued_requests));
+    policy.deadline_ms = static_cast<uint64_t>(std::max(0, settings.request_deadline_ms));
+    policy.workers = workers;
+    admission_.set_policy(policy);
 }
 
 void RestServer::on_new_connection() {
     while (QTcpSocket* socket = tcp_server_->nextPendingConnection()) {
+        if (!admission_.acquire_connection()) {
+            // Over the cap: answer once and hang up without reading anything
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            socket->write(rejection(AdmissionController::Decision::Overloaded, 1, false).data);
+            socket->disconnectFromHost();
+            continue;
+        }
+        
+        socket->setReadBufferSize(kReadBufferBytes);
+        
+        Connection connection;
+        connection.id = next_connection_id_++;
+        connection_sockets_.emplace(connection.id, socket);
+        connections_.emplace(socket, std::move(connection));
         connect(socket, &QTcpSocket::readyRead, this, &RestServer::on_read_ready);
+        connect(socket, &QTcpSocket::bytesWritten, this, &RestServer::on_bytes_written);
         connect(socket, &QTcpSocket::disconnected, this, &RestServer::on_disconnected);
     }
 }
@@ -39,53 +79,188 @@ void RestServer::on_read_ready() {
     QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
     if (!socket) return;
     
-    QString raw_data = QString::fromUtf8(socket->readAll());
-    auto request = parse_http_request(raw_data);
+    auto it = connections_.find(socket);
+    if (it == connections_.end()) return;
+    
+    read_requests(socket, it->second);
+}
+
+void RestServer::on_bytes_written() {
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket) return;
     
-    QString response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    auto it = connections_.find(socket);
+    if (it == connections_.end()) return;
     
-    if (!engine_) {
-        socket->write(response.toUtf8());
+    // The write backlog shrank; resume if it was what paused reading
+    read_requests(socket, it->second);
+}
+
+void RestServer::read_requests(QTcpSocket* socket, Connection& connection) {
+    // Requests already buffered go first. More bytes are read only while the
+    // pipeline has room and earlier responses are mostly sent; otherwise they
+    // wait in the socket's bounded buffer until on_response_ready() or
+    // on_bytes_written() comes back here
+    if (!process_requests(socket, connection)) return;
+    if (connection.closing || socket->bytesToWrite() > kWriteBacklogBytes ||
+        connection.next_sequence - connection.next_to_write >= kMaxPipelinedRequests) {
+        return;
+    }
+    
+    {
+        BRAINLLM_TRACE_SCOPE("http", "read");
+        // Buffer whatever arrived; the parser decides when a request is complete
+        QByteArray data = socket->readAll();
+        connection.parser.feed(data.constData(), static_cast<size_t>(data.size()));
     }
     
-    socket->flush();
-    socket->close();
+    process_requests(socket, connection);
 }
 
 void RestServer::on_disconnected() {
     QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
     if (socket) {
+        auto it = connections_.find(socket);
+        if (it != connections_.end()) {
+            connection_sockets_.erase(it->second.id);
+            connections_.erase(it);
+            admission_.release_connection();
+        }
         socket->deleteLater();
     }
 }
 
-RestServer::HttpRequest RestServer::parse_http_request(const QString& raw_request) {
+bool RestServer::process_requests(QTcpSocket* socket, Connection& connection) {
     HttpRequest request;
-    QStringList lines = raw_request.split("\r\n");
     
-    if (lines.size() > 0) {
-        QStringList first_line = lines[0].split(" ");
-        if (first_line.size() >= 2) {
-            request.method = first_line[0];
-            request.path = first_line[1];
+    // Dispatch every complete request; pipelined requests run concurrently
+    // and their responses are reordered in flush_responses()
+    while (!connection.closing &&
+           connection.next_sequence - connection.next_to_write < kMaxPipelinedRequests) {
+        auto result = connection.parser.next(request);
+        if (result == HttpParser::Result::NeedMore) break;
+        
+        uint64_t sequence = connection.next_sequence++;
+        
+        if (result == HttpParser::Result::Error) {
+            connection.closing = true;
+            connection.completed.emplace(sequence, PendingResponse{
+                build_http_response(std::string(), connection.parser.error_status(), false), true});
+            break;
+        }
+        
+        if (!request.keep_alive) {
+            connection.closing = true;
         }
+        
+        int retry_after = 0;
+        auto decision = admission_.admit(request, socket->peerAddress().toString().toStdString(), retry_after);
+        if (decision != AdmissionController::Decision::Admit) {
+            connection.completed.emplace(sequence, rejection(decision, retry_after, request.keep_alive));
+            continue;
+        }
+        dispatch(connection.id, sequence, std::move(request));
     }
     
-    // Parse headers
-    int body_start = raw_request.indexOf("\r\n\r\n");
-    if (body_start != -1) {
-        request.body = raw_request.mid(body_start + 4);
-    }
+    return flush_responses(socket, connection);
+}
+
+void RestServer::dispatch(uint64_t connection_id, uint64_t sequence, HttpRequest request) {
+    // The handler is captured by value so set_llm_engine() cannot pull it
+    // out from under a running worker
+    std::shared_ptr<RequestHandler> handler = handler_;
+    uint64_t enqueued = monotonic_nanoseconds();
     
-    return request;
+    worker_pool_->start([this, handler, connection_id, sequence, enqueued, request = std::move(request)]() {
+        // Each worker keeps one body buffer; its capacity is reused across requests
+        thread_local std::string body_buffer;
+        BRAINLLM_TRACE_SCOPE("http", "dispatch");
+        
+        PendingResponse response;
+        if (!admission_.start(enqueued)) {
+            // Waited past the deadline; the client has likely given up
+            response = rejection(AdmissionController::Decision::Overloaded, 1, request.keep_alive);
+        } else {
+            uint64_t started = monotonic_nanoseconds();
+            ApiResponse result = handler ? handler->handle_request(request, std::move(body_buffer))
+                                         : ApiResponse{503, "{\"error\":\"Engine not initialized\"}"};
+            admission_.finish(monotonic_nanoseconds() - started);
+            
+            response = PendingResponse{
+                build_http_response(result.body, result.status_code, request.keep_alive, result.content_type),
+                !request.keep_alive};
+            body_buffer = std::move(result.body);
+        }
+        
+        QMetaObject::invokeMethod(this, [this, connection_id, sequence, response]() {
+            on_response_ready(connection_id, sequence, response);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void RestServer::on_response_ready(uint64_t connection_id, uint64_t sequence, const PendingResponse& response) {
+    auto socket_it = connection_sockets_.find(connection_id);
+    if (socket_it == connection_sockets_.end()) return;  // Client already went away
+    
+    QTcpSocket* socket = socket_it->second;
+    auto it = connections_.find(socket);
+    if (it == connections_.end()) return;
+    
+    Connection& connection = it->second;
+    connection.completed.emplace(sequence, response);
+    
+    // Writing may have freed pipeline slots, so resume parsing buffered
+    // requests and reading whatever was held back while the pipeline was full
+    if (flush_responses(socket, connection) && !connection.closing) {
+        read_requests(socket, connection);
+    }
 }
 
-QString RestServer::build_http_response(const QString& body, int status_code) {
-    QString status_text = (status_code == 200) ? "OK" : "Error";
-    QString response = QString("HTTP/1.1 %1 %2\r\n").arg(status_code).arg(status_text);
-    response += "Content-Type: application/json\r\n";
-    response += QString("Content-Length: %1\r\n\r\n").arg(body.length());
-    response += body;
+bool RestServer::flush_responses(QTcpSocket* socket, Connection& connection) {
+    BRAINLLM_TRACE_SCOPE("http", "write");
+    while (true) {
+        auto next = connection.completed.find(connection.next_to_write);
+        if (next == connection.completed.end()) return true;
+        
+        bool close_after = next->second.close_after;
+        socket->write(next->second.data);
+        connection.completed.erase(next);
+        ++connection.next_to_write;
+        
+        if (close_after) {
+            // disconnectFromHost() flushes pending writes but may emit
+            // disconnected() synchronously and drop this connection's state
+            socket->disconnectFromHost();
+            return false;
+        }
+    }
+}
+
+RestServer::PendingResponse RestServer::rejection(AdmissionController::Decision decision, int retry_after_seconds,
+                                                 bool keep_alive) {
+    switch (decision) {
+        case AdmissionController::Decision::Unauthorized:
+            return {build_http_response("{\"error\":\"Missing or invalid API key\"}", 401, keep_alive),
+                    !keep_alive};
+        case AdmissionController::Decision::RateLimited:
+            return {build_http_response("{\"error\":\"Rate limit exceeded\"}", 429, keep_alive,
+                                        "application/json", retry_after_seconds),
+                    !keep_alive};
+        default:
+            return {build_http_response("{\"error\":\"Server overloaded\"}", 503, keep_alive,
+                                        "application/json", retry_after_seconds),
+                    !keep_alive};
+    }
+}
+
+QByteArray RestServer::build_http_response(const std::string& body, int status_code, bool keep_alive,
+                                           const char* content_type, int retry_after_seconds) {
+    std::string head = http_response_head(status_code, body.size(), keep_alive, content_type, retry_after_seconds);
+    
+    QByteArray response;
+    response.reserve(static_cast<qsizetype>(head.size() + body.size()));
+    response.append(head.data(), static_cast<qsizetype>(head.size()));
+    response.append(body.data(), static_cast<qsizetype>(body.size()));
     return response;
 }
 
@@ -0,0 +1,357 @@
+#include "checkpoint.h"
+#include "metrics.h"
+#include "trace.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define BRAINLLM_HAS_FSYNC 1
+#endif
+
+namespace BrainLLM {
+
+namespace {
+
+constexpr char kMagic[8] = {'B', 'L', 'L', 'M', 'C', 'K', 'P', 'T'};
+constexpr uint32_t kFormatVersion = 1;
+constexpr const char* kFilePrefix = "checkpoint-";
+constexpr const char* kFileSuffix = ".bin";
+
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Buffered file output that checksums everything it writes
+class ChecksumWriter {
+public:
+    explicit ChecksumWriter(const std::string& path) {
+#if defined(BRAINLLM_HAS_FSYNC)
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ok_ = fd_ >= 0;
+#else
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        ok_ = static_cast<bool>(file_);
+#endif
+        buffer_.reserve(kBufferBytes);
+    }
+    
+    ~ChecksumWriter() {
+#if defined(BRAINLLM_HAS_FSYNC)
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+    
+    void put(const void* data, size_t size) {
+        hash_ = fnv1a(hash_, data, size);
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0 && ok_) {
+            size_t take = std::min(size, kBufferBytes - buffer_.size());
+            buffer_.insert(buffer_.end(), bytes, bytes + take);
+            bytes += take;
+            size -= take;
+            if (buffer_.size() == kBufferBytes) drain();
+        }
+    }
+    
+    template <typename T>
+    void put_value(T value) { put(&value, sizeof(value)); }
+    
+    // Appends the checksum, then flushes and syncs the file
+    bool finish() {
+        uint64_t checksum = hash_;
+        put(&checksum, sizeof(checksum));
+        drain();
+#if defined(BRAINLLM_HAS_FSYNC)
+        if (ok_ && ::fsync(fd_) != 0) ok_ = false;
+#else
+        file_.flush();
+        ok_ = ok_ && static_cast<bool>(file_);
+#endif
+        return ok_;
+    }
+
+private:
+    static constexpr size_t kBufferBytes = 1 << 20;
+    
+    std::vector<char> buffer_;
+    uint64_t hash_ = 14695981039346656037ULL;
+    bool ok_ = false;
+#if defined(BRAINLLM_HAS_FSYNC)
+    int fd_ = -1;
+#else
+    std::ofstream file_;
+#endif
+
+    void drain() {
+        if (!ok_ || buffer_.empty()) return;
+#if defined(BRAINLLM_HAS_FSYNC)
+        const char* data = buffer_.data();
+        size_t remaining = buffer_.size();
+        while (remaining > 0) {
+            ssize_t written = ::write(fd_, data, remaining);
+            if (written < 0) {
+                ok_ = false;
+                break;
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+#else
+        file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        ok_ = static_cast<bool>(file_);
+#endif
+        buffer_.clear();
+    }
+};
+
+class ChecksumReader {
+public:
+    explicit ChecksumReader(const std::string& path) : file_(path, std::ios::binary) {
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(path, error);
+        remaining_ = error ? 0 : size;
+    }
+    
+    bool get(void* data, size_t size) {
+        if (size > remaining_) return false;
+        if (!file_.read(static_cast<char*>(data), static_cast<std::streamsize>(size))) return false;
+        hash_ = fnv1a(hash_, data, size);
+        remaining_ -= size;
+        return true;
+    }
+    
+    // Unread bytes, so sizes taken from the file can be checked before
+    // anything is allocated for them
+    uint64_t remaining() const { return remaining_; }
+    
+    template <typename T>
+    bool get_value(T& value) { return get(&value, sizeof(value)); }
+    
+    // Reads the trailing checksum and checks it ends the file
+    bool verify() {
+        uint64_t expected = hash_;
+        uint64_t stored = 0;
+        if (!file_.read(reinterpret_cast<char*>(&stored), sizeof(stored))) return false;
+        return stored == expected && file_.peek() == std::char_traits<char>::eof();
+    }
+
+private:
+    std::ifstream file_;
+    uint64_t hash_ = 14695981039346656037ULL;
+    uint64_t remaining_;
+};
+
+#if defined(BRAINLLM_HAS_FSYNC)
+// A rename is only durable once the directory entry itself is synced
+void sync_directory(const std::string& directory) {
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+}
+#endif
+
+} // namespace
+
+const CheckpointTensor* Checkpoint::find(const std::string& name) const {
+    for (const auto& tensor : tensors) {
+        if (tensor.name == name) return &tensor;
+    }
+    return nullptr;
+}
+
+bool Checkpoint::write(const std::string& path) const {
+    ChecksumWriter out(path);
+    out.put(kMagic, sizeof(kMagic));
+    out.put_value(kFormatVersion);
+    out.put_value(step);
+    out.put_value(static_cast<uint32_t>(tensors.size()));
+    for (const auto& tensor : tensors) {
+        out.put_value(static_cast<uint32_t>(tensor.name.size()));
+        out.put(tensor.name.data(), tensor.name.size());
+        out.put_value(tensor.rows);
+        out.put_value(tensor.cols);
+        out.put(tensor.data.data(), tensor.data.size() * sizeof(float));
+    }
+    return out.finish();
+}
+
+bool Checkpoint::read(const std::string& path) {
+    ChecksumReader in(path);
+    char magic[sizeof(kMagic)];
+    uint32_t version = 0;
+    uint32_t count = 0;
+    if (!in.get(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) return false;
+    if (!in.get_value(version) || version != kFormatVersion) return false;
+    if (!in.get_value(step) || !in.get_value(count)) return false;
+    
+    // Every tensor needs at least its name length, rows and cols, so a
+    // corrupt count is rejected before it sizes anything
+    constexpr uint64_t kMinTensorBytes = sizeof(uint32_t) * 3;
+    if (count > in.remaining() / kMinTensorBytes) return false;
+    
+    tensors.resize(count);
+    for (auto& tensor : tensors) {
+        uint32_t name_length = 0;
+        if (!in.get_value(name_length) || name_length > 4096) return false;
+        tensor.name.resize(name_length);
+        if (!in.get(&tensor.name[0], name_length)) return false;
+        if (!in.get_value(tensor.rows) || !in.get_value(tensor.cols)) return false;
+        uint64_t elements = static_cast<uint64_t>(tensor.rows) * tensor.cols;
+        if (elements > in.remaining() / sizeof(float)) return false;
+        tensor.data.resize(static_cast<size_t>(elements));
+        if (!in.get(tensor.data.data(), tensor.data.size() * sizeof(float))) return false;
+    }
+    return in.verify();
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& directory, size_t keep_last)
+    : directory_(directory), keep_last_(std::max<size_t>(1, keep_last)), running_(true),
+      writing_(false), has_pending_(false) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    thread_ = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    work_available_.notify_all();
+    // The pending checkpoint is still written, bounding the work lost at exit
+    thread_.join();
+}
+
+Checkpoint CheckpointWriter::take_buffer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spare_.empty()) return Checkpoint();
+    Checkpoint buffer = std::move(spare_.back());
+    spare_.pop_back();
+    return buffer;
+}
+
+void CheckpointWriter::submit(Checkpoint checkpoint) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (has_pending_) {
+            ++stats_.superseded;
+            runtime_metrics().checkpoints_superseded.add();
+            spare_.push_back(std::move(pending_));
+        }
+        pending_ = std::move(checkpoint);
+        has_pending_ = true;
+    }
+    work_available_.notify_one();
+}
+
+void CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return !has_pending_ && !writing_; });
+}
+
+CheckpointWriter::Stats CheckpointWriter::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+std::string CheckpointWriter::find_latest(const std::string& directory) {
+    auto checkpoints = list_checkpoints(directory);
+    return checkpoints.empty() ? std::string() : checkpoints.back().second;
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_available_.wait(lock, [this] { return has_pending_ || !running_; });
+        if (!has_pending_) break;
+        
+        Checkpoint checkpoint = std::move(pending_);
+        has_pending_ = false;
+        writing_ = true;
+        lock.unlock();
+        
+        std::string path;
+        bool ok = write_checkpoint(checkpoint, path);
+        if (ok) prune();
+        
+        lock.lock();
+        writing_ = false;
+        if (ok) {
+            ++stats_.written;
+            stats_.last_path = path;
+        } else {
+            ++stats_.failed;
+        }
+        spare_.push_back(std::move(checkpoint));
+        idle_.notify_all();
+    }
+}
+
+bool CheckpointWriter::write_checkpoint(const Checkpoint& checkpoint, std::string& path) {
+    BRAINLLM_TRACE_SCOPE("checkpoint", "CheckpointWriter::write");
+    RuntimeMetrics& metrics = runtime_metrics();
+    ScopedTimer timer(metrics.checkpoint_write_duration);
+    
+    path = (std::filesystem::path(directory_) / (kFilePrefix + std::to_string(checkpoint.step) + kFileSuffix)).string();
+    std::string staging = path + ".tmp";
+    if (!checkpoint.write(staging) || std::rename(staging.c_str(), path.c_str()) != 0) {
+        std::remove(staging.c_str());
+        metrics.checkpoints_failed.add();
+        return false;
+    }
+#if defined(BRAINLLM_HAS_FSYNC)
+    sync_directory(directory_);
+#endif
+    metrics.checkpoints_written.add();
+    return true;
+}
+
+void CheckpointWriter::prune() {
+    auto checkpoints = list_checkpoints(directory_);
+    if (checkpoints.size() <= keep_last_) return;
+    
+    std::error_code error;
+    for (size_t i = 0; i + keep_last_ < checkpoints.size(); ++i) {
+        std::filesystem::remove(checkpoints[i].second, error);
+    }
+}
+
+std::vector<std::pair<uint64_t, std::string>> CheckpointWriter::list_checkpoints(const std::string& directory) {
+    // Oldest first, by step; staging files never match the name pattern
+    std::vector<std::pair<uint64_t, std::string>> checkpoints;
+    std::error_code error;
+    const std::string prefix = kFilePrefix;
+    const std::string suffix = kFileSuffix;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        // from_chars rejects signs and overflow without throwing, so a stray
+        // file cannot take down the writer thread that prunes this directory
+        const char* first = name.data() + prefix.size();
+        const char* last = name.data() + name.size() - suffix.size();
+        uint64_t step = 0;
+        auto parsed = std::from_chars(first, last, step);
+        if (parsed.ec != std::errc() || parsed.ptr != last) continue;
+        checkpoints.emplace_back(step, entry.path().string());
+    }
+    std::sort(checkpoints.begin(), checkpoints.end());
+    return checkpoints;
+}
+
+} // namespace BrainLLM
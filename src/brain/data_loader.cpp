@@ -0,0 +1,336 @@
+#include "data_loader.h"
+#include "json_reader.h"
+#include "trace.h"
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BRAINLLM_HAS_MMAP 1
+#else
+#include <fstream>
+#include <sstream>
+#endif
+
+namespace BrainLLM {
+
+namespace {
+
+// Documents are joined with the byte token for '\n'
+constexpr int kDocumentSeparator = '\n';
+
+} // namespace
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#if defined(BRAINLLM_HAS_MMAP)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ == 0) {
+        ::close(fd);
+        return true;
+    }
+    
+    void* memory = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file referenced
+    if (memory == MAP_FAILED) {
+        size_ = 0;
+        return false;
+    }
+    
+    // Chunks are read front to back, so ask for aggressive readahead
+    ::madvise(memory, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(memory);
+    mapped_ = true;
+    return true;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    fallback_ = contents.str();
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#if defined(BRAINLLM_HAS_MMAP)
+    if (mapped_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    std::string().swap(fallback_);
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+}
+
+DataLoader::DataLoader(const DataLoaderOptions& options, std::shared_ptr<const BpeTokenizer> tokenizer)
+    : options_(options), tokenizer_(std::move(tokenizer)), next_chunk_(0), running_(false),
+      active_workers_(0), batches_done_(false) {}
+
+DataLoader::~DataLoader() {
+    stop();
+}
+
+bool DataLoader::start() {
+    if (running_) return true;
+    if (!tokenizer_ || options_.paths.empty() || options_.sequence_length == 0 || options_.batch_size == 0) {
+        error_ = "Data loader needs a tokenizer, corpus paths and non-zero sequence and batch sizes";
+        return false;
+    }
+    
+    files_.clear();
+    for (const auto& path : options_.paths) {
+        auto file = std::make_unique<MappedFile>();
+        if (!file->open(path)) {
+            error_ = "Cannot read " + path;
+            files_.clear();
+            return false;
+        }
+        files_.push_back(std::move(file));
+    }
+    
+    uint64_t seed = options_.seed;
+    if (seed == 0) {
+        std::random_device entropy;
+        seed = (static_cast<uint64_t>(entropy()) << 32) | entropy();
+    }
+    rng_.seed(seed);
+    
+    split_chunks();
+    if (options_.shuffle_window > 1) {
+        std::shuffle(chunks_.begin(), chunks_.end(), rng_);
+    }
+    
+    size_t workers = std::max<size_t>(1, options_.worker_threads);
+    window_.clear();
+    ready_.clear();
+    next_chunk_ = 0;
+    running_ = true;
+    batches_done_ = false;
+    active_workers_ = workers;
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back(&DataLoader::work, this);
+    }
+    assembler_ = std::thread(&DataLoader::assemble, this);
+    return true;
+}
+
+void DataLoader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    window_space_.notify_all();
+    window_ready_.notify_all();
+    batch_space_.notify_all();
+    batch_ready_.notify_all();
+    
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    if (assembler_.joinable()) {
+        assembler_.join();
+    }
+}
+
+bool DataLoader::next_batch(TokenBatch& batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (ready_.empty()) {
+        ++stats_.trainer_waits;
+    }
+    batch_ready_.wait(lock, [this] { return !ready_.empty() || batches_done_ || !running_; });
+    if (ready_.empty()) return false;
+    
+    if (batch.tokens.capacity() > 0) {
+        spare_batches_.push_back(std::move(batch));
+    }
+    batch = std::move(ready_.front());
+    ready_.erase(ready_.begin());
+    ++stats_.batches;
+    batch_space_.notify_one();
+    return true;
+}
+
+DataLoader::Stats DataLoader::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void DataLoader::split_chunks() {
+    chunks_.clear();
+    size_t target = std::max<size_t>(1, options_.chunk_bytes);
+    for (size_t f = 0; f < files_.size(); ++f) {
+        std::string_view text = files_[f]->view();
+        size_t begin = 0;
+        while (begin < text.size()) {
+            // Extend each chunk to the end of its last line
+            size_t end = std::min(text.size(), begin + target);
+            if (end < text.size()) {
+                size_t newline = text.find('\n', end - 1);
+                end = newline == std::string_view::npos ? text.size() : newline + 1;
+            }
+            chunks_.push_back({f, begin, end});
+            begin = end;
+        }
+    }
+}
+
+bool DataLoader::claim_chunk(Chunk& chunk) {
+    if (chunks_.empty()) return false;
+    size_t index = next_chunk_.fetch_add(1, std::memory_order_relaxed);
+    if (!options_.repeat && index >= chunks_.size()) return false;
+    chunk = chunks_[index % chunks_.size()];
+    return true;
+}
+
+void DataLoader::work() {
+    std::vector<int> packed;
+    Chunk chunk;
+    while (claim_chunk(chunk)) {
+        size_t documents = tokenize_chunk(chunk, packed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.bytes += chunk.end - chunk.begin;
+            stats_.documents += documents;
+        }
+        if (!emit_sequences(packed)) break;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--active_workers_ == 0) {
+        window_ready_.notify_all();
+    }
+}
+
+size_t DataLoader::tokenize_chunk(const Chunk& chunk, std::vector<int>& packed) {
+    BRAINLLM_TRACE_SCOPE("data", "DataLoader::tokenize_chunk");
+    std::string_view text = files_[chunk.file]->view().substr(chunk.begin, chunk.end - chunk.begin);
+    JsonReader reader;
+    std::string field;
+    size_t documents = 0;
+    
+    while (!text.empty()) {
+        size_t newline = text.find('\n');
+        std::string_view line = text.substr(0, newline);
+        text = newline == std::string_view::npos ? std::string_view() : text.substr(newline + 1);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.find_first_not_of(" \t") == std::string_view::npos) continue;
+        
+        std::string_view document = line;
+        if (options_.format == CorpusFormat::JsonLines) {
+            // Lines that are not objects with a string text field are skipped
+            if (!reader.parse(line)) continue;
+            JsonValue value = reader.root()[options_.text_field];
+            if (!value.is_string()) continue;
+            field = value.as_string();
+            document = field;
+        }
+        
+        std::vector<int> ids = tokenizer_->encode(document);
+        packed.insert(packed.end(), ids.begin(), ids.end());
+        packed.push_back(kDocumentSeparator);
+        ++documents;
+    }
+    return documents;
+}
+
+bool DataLoader::emit_sequences(std::vector<int>& packed) {
+    size_t length = options_.sequence_length;
+    size_t capacity = std::max<size_t>(1, options_.shuffle_window);
+    size_t consumed = 0;
+    
+    while (packed.size() - consumed >= length) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        window_space_.wait(lock, [this, capacity] { return !running_ || window_.size() < capacity; });
+        if (!running_) return false;
+        
+        // Fill all the room there is under one lock
+        while (window_.size() < capacity && packed.size() - consumed >= length) {
+            std::vector<int> sequence;
+            if (!spare_.empty()) {
+                sequence = std::move(spare_.back());
+                spare_.pop_back();
+            }
+            sequence.assign(packed.begin() + consumed, packed.begin() + consumed + length);
+            window_.push_back(std::move(sequence));
+            consumed += length;
+            ++stats_.sequences;
+        }
+        window_ready_.notify_one();
+    }
+    
+    packed.erase(packed.begin(), packed.begin() + consumed);
+    return true;
+}
+
+void DataLoader::assemble() {
+    size_t length = options_.sequence_length;
+    size_t capacity = std::max<size_t>(1, options_.shuffle_window);
+    
+    while (true) {
+        TokenBatch batch;
+        size_t count = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!spare_batches_.empty()) {
+                batch = std::move(spare_batches_.back());
+                spare_batches_.pop_back();
+            }
+            batch.sequence_length = length;
+            batch.tokens.resize(options_.batch_size * length);
+            
+            while (count < options_.batch_size) {
+                // Draw only from a full window, so every pick has the whole
+                // window to choose from, until the workers have finished
+                window_ready_.wait(lock, [this, capacity] {
+                    return !running_ || window_.size() >= capacity || active_workers_ == 0;
+                });
+                if (!running_) return;
+                if (window_.empty()) break;
+                
+                size_t pick = std::uniform_int_distribution<size_t>(0, window_.size() - 1)(rng_);
+                std::swap(window_[pick], window_.back());
+                std::copy(window_.back().begin(), window_.back().end(), batch.tokens.begin() + count * length);
+                spare_.push_back(std::move(window_.back()));
+                window_.pop_back();
+                ++count;
+                window_space_.notify_one();
+            }
+        }
+        
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (count == 0) {
+            batches_done_ = true;
+            batch_ready_.notify_all();
+            return;
+        }
+        batch.count = count;
+        batch.tokens.resize(count * length);
+        
+        batch_space_.wait(lock, [this] { return !running_ || ready_.size() < kPrefetchBatches; });
+        if (!running_) return;
+        ready_.push_back(std::move(batch));
+        batch_ready_.notify_one();
+    }
+}
+
+} // namespace BrainLLM
@@ -0,0 +1,212 @@
+#include "decode_scheduler.h"
+#include "metrics.h"
+#include "trace.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace BrainLLM {
+
+DecodeScheduler::DecodeScheduler(std::shared_ptr<LLMEngine> engine, size_t max_batch_size,
+                                 size_t max_batch_tokens)
+    : engine_(engine), max_batch_size_(std::max<size_t>(1, max_batch_size)),
+      max_batch_tokens_(std::max<size_t>(1, max_batch_tokens)), running_(false),
+      reserved_tokens_(0), active_count_(0) {}
+
+DecodeScheduler::~DecodeScheduler() {
+    stop();
+}
+
+void DecodeScheduler::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_ || !engine_) return;
+    
+    running_ = true;
+    thread_ = std::thread(&DecodeScheduler::run, this);
+}
+
+void DecodeScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    work_available_.notify_all();
+    
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool DecodeScheduler::is_running() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+std::future<std::string> DecodeScheduler::submit(const std::string& prompt, const GenerationOptions& options) {
+    auto sequence = std::make_unique<Sequence>();
+    sequence->prompt = prompt;
+    sequence->options = options;
+    sequence->reserved = static_cast<size_t>(std::max(1, options.max_tokens));
+    std::future<std::string> result = sequence->result.get_future();
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            sequence->result.set_exception(
+                std::make_exception_ptr(std::runtime_error("Decode scheduler is not running")));
+            return result;
+        }
+        queue_.push_back(std::move(sequence));
+        runtime_metrics().decode_queue_depth.add(1);
+    }
+    work_available_.notify_one();
+    
+    return result;
+}
+
+std::string DecodeScheduler::generate(const std::string& prompt, const GenerationOptions& options) {
+    return submit(prompt, options).get();
+}
+
+size_t DecodeScheduler::get_active_count() const {
+    return active_count_.load(std::memory_order_relaxed);
+}
+
+size_t DecodeScheduler::get_queued_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void DecodeScheduler::run() {
+    std::vector<std::unique_ptr<Sequence>> admitted;
+    
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_available_.wait(lock, [this] {
+                return !running_ || !queue_.empty() || !active_.empty();
+            });
+            if (!running_) break;
+            
+            // New requests join between steps, never in the middle of one
+            admit(admitted);
+        }
+        
+        // Prefixes read the memory system, so they are built outside our lock
+        for (auto& sequence : admitted) {
+            sequence->response = engine_->begin_generation(sequence->prompt);
+            sequence->sampler = engine_->make_sampler(sequence->options);
+            if (sequence->options.max_tokens <= 0) {
+                reserved_tokens_ -= sequence->reserved;
+                engine_->end_generation(sequence->prompt, sequence->response, sequence->options.session_id);
+                sequence->result.set_value(std::move(sequence->response));
+                continue;
+            }
+            contexts_.push_back(sequence->prompt + sequence->response);
+            active_.push_back(std::move(sequence));
+        }
+        admitted.clear();
+        set_active_count(active_.size());
+        
+        if (!active_.empty()) {
+            step();
+        }
+    }
+    
+    // Shutting down: nothing in flight will complete
+    auto stopped = std::make_exception_ptr(std::runtime_error("Decode scheduler stopped"));
+    for (auto& sequence : active_) {
+        sequence->result.set_exception(stopped);
+    }
+    active_.clear();
+    contexts_.clear();
+    reserved_tokens_ = 0;
+    set_active_count(0);
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& sequence : queue_) {
+        sequence->result.set_exception(stopped);
+    }
+    runtime_metrics().decode_queue_depth.add(-static_cast<int64_t>(queue_.size()));
+    queue_.clear();
+}
+
+void DecodeScheduler::admit(std::vector<std::unique_ptr<Sequence>>& admitted) {
+    size_t queued = queue_.size();
+    while (!queue_.empty() && active_.size() + admitted.size() < max_batch_size_) {
+        Sequence& head = *queue_.front();
+        
+        // An idle scheduler always takes the head, even if it alone exceeds
+        // the token budget; otherwise the head waits and nothing overtakes it
+        bool idle = active_.empty() && admitted.empty();
+        if (!idle && reserved_tokens_ + head.reserved > max_batch_tokens_) break;
+        
+        reserved_tokens_ += head.reserved;
+        admitted.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+    }
+    runtime_metrics().decode_queue_depth.add(-static_cast<int64_t>(queued - queue_.size()));
+}
+
+void DecodeScheduler::step() {
+    BRAINLLM_TRACE_SCOPE("scheduler", "DecodeScheduler::step");
+    samplers_.clear();
+    for (auto& sequence : active_) {
+        samplers_.push_back(&sequence->sampler);
+    }
+    
+    std::vector<std::vector<DecodedToken>> tokens;
+    try {
+        tokens = engine_->decode_step(contexts_, samplers_);
+    } catch (...) {
+        auto error = std::current_exception();
+        for (auto& sequence : active_) {
+            sequence->result.set_exception(error);
+        }
+        active_.clear();
+        contexts_.clear();
+        reserved_tokens_ = 0;
+        set_active_count(0);
+        return;
+    }
+    
+    // Walk backwards so retire() can swap the last sequence into slot i
+    for (size_t i = active_.size(); i-- > 0;) {
+        Sequence& sequence = *active_[i];
+        bool finished = false;
+        for (const DecodedToken& token : tokens[i]) {
+            sequence.response += token.symbol;
+            contexts_[i] += token.symbol;
+            ++sequence.generated;
+            
+            finished = token.end_of_sequence || sequence.generated >= sequence.options.max_tokens;
+            if (finished) break;
+        }
+        
+        if (finished) {
+            retire(i);
+        }
+    }
+    set_active_count(active_.size());
+}
+
+void DecodeScheduler::set_active_count(size_t count) {
+    size_t previous = active_count_.exchange(count, std::memory_order_relaxed);
+    runtime_metrics().decode_active_sequences.add(static_cast<int64_t>(count) - static_cast<int64_t>(previous));
+}
+
+void DecodeScheduler::retire(size_t index) {
+    Sequence& sequence = *active_[index];
+    reserved_tokens_ -= sequence.reserved;
+    engine_->end_generation(sequence.prompt, sequence.response, sequence.options.session_id);
+    sequence.result.set_value(std::move(sequence.response));
+    
+    if (index != active_.size() - 1) {
+        std::swap(active_[index], active_.back());
+        std::swap(contexts_[index], contexts_.back());
+    }
+    active_.pop_back();
+    contexts_.pop_back();
+}
+
+} // namespace BrainLLM
@@ -1,107 +1,552 @@
 #include "llm_engine.h"
+#include "trace.h"
 #include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <random>
 #include <sstream>
+#include <thread>
 
 namespace BrainLLM {
 
+namespace {
+
+// The draft shares the main network's shape except for depth, so both
+// produce distributions over the same outputs
+std::unique_ptr<NeuralNetwork> make_draft_network(const BrainConfig& config) {
+    if (config.speculative_tokens <= 0) return nullptr;
+    
+    BrainConfig draft = config;
+    draft.num_layers = std::max(1, std::min(config.draft_layers, config.num_layers));
+    return std::make_unique<NeuralNetwork>(draft);
+}
+
+// Confidence recorded for a completed exchange
+constexpr float kResponseConfidence = 0.75f;
+
+// Counts an inference call in flight for get_state()
+class ActiveRequest {
+public:
+    explicit ActiveRequest(std::atomic<int>& count) : count_(count) {
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    ~ActiveRequest() { count_.fetch_sub(1, std::memory_order_relaxed); }
+    
+    ActiveRequest(const ActiveRequest&) = delete;
+    ActiveRequest& operator=(const ActiveRequest&) = delete;
+
+private:
+    std::atomic<int>& count_;
+};
+
+DecodedToken make_token(const Activation& output, int index) {
+    // The sequence ends when the network has no confident continuation,
+    // whichever token the sampler picks
+    float peak = *std::max_element(output.begin(), output.end());
+    return {char(32 + (index % 94)), output[index], peak < 0.3f};
+}
+
+} // namespace
+
 LLMEngine::LLMEngine(const BrainConfig& config)
-    : config_(config), state_(BrainState::Idle), confidence_(0.0f) {
+    : config_(config), state_(BrainState::Idle), active_requests_(0), sampled_tokens_generated_(0),
+      model_version_(0), memory_version_(0), checkpoint_interval_(0), training_steps_(0) {
     neural_net_ = std::make_unique<NeuralNetwork>(config);
+    draft_net_ = make_draft_network(config);
     memory_ = std::make_unique<MemorySystem>(config.max_memory_size);
     attention_ = std::make_unique<AttentionMechanism>(config.num_attention_heads, config.embedding_dim);
+    tokenizer_ = std::make_shared<const BpeTokenizer>();
+    record_weight_bytes_locked();
 }
 
-std::string LLMEngine::process_input(const std::string& input) {
-    state_ = BrainState::Processing;
+std::string LLMEngine::process_input(const std::string& input, const std::string& session_id) {
+    BRAINLLM_TRACE_SCOPE("engine", "LLMEngine::process_input");
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    ActiveRequest active(active_requests_);
     
-    context_.current_input = input;
     auto encoded = encode_input(input);
     auto output = neural_net_->forward(encoded);
     auto response = decode_output(output);
     
-    context_.last_output = response;
-    confidence_ = 0.75f;
+    sessions_.record_turn(session_id, input, response, kResponseConfidence);
+    store_interaction_locked(input, response, kResponseConfidence);
     
-    store_interaction(input, response);
-    
-    state_ = BrainState::Idle;
     return response;
 }
 
+std::vector<std::string> LLMEngine::process_batch(const std::vector<std::string>& inputs,
+                                                  const std::string& session_id) {
+    BRAINLLM_TRACE_SCOPE("engine", "LLMEngine::process_batch");
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    ActiveRequest active(active_requests_);
+    
+    std::vector<Activation> encoded;
+    encoded.reserve(inputs.size());
+    for (const auto& input : inputs) {
+        encoded.push_back(encode_input(input));
+    }
+    
+    // One batched forward pass for the whole request
+    auto outputs = neural_net_->forward_batch(encoded);
+    
+    std::vector<std::string> responses;
+    responses.reserve(outputs.size());
+    for (const auto& output : outputs) {
+        responses.push_back(decode_output(output));
+    }
+    
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        sessions_.record_turn(session_id, inputs[i], responses[i], kResponseConfidence);
+    }
+    store_interactions_locked(inputs, responses, kResponseConfidence);
+    
+    return responses;
+}
+
 std::string LLMEngine::generate_response(const std::string& prompt, int max_tokens) {
-    state_ = BrainState::Processing;
+    GenerationOptions options;
+    options.max_tokens = max_tokens;
+    return generate_response(prompt, options);
+}
+
+std::string LLMEngine::generate_response(const std::string& prompt, const GenerationOptions& options) {
+    BRAINLLM_TRACE_SCOPE("engine", "LLMEngine::generate_response");
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    ActiveRequest active(active_requests_);
     
-    std::string response = "AI Response: ";
+    std::string response = begin_generation_locked(prompt);
+    Sampler sampler(sampling_params_locked(options));
+    std::vector<Sampler*> samplers{&sampler};
     
-    // Retrieve relevant memories
-    auto memories = memory_->retrieve_memories(prompt, 3);
-    if (!memories.empty()) {
-        response += "Based on memory: " + memories[0].content + ". ";
+    std::vector<std::string> context(1);
+    bool finished = false;
+    for (int generated = 0; generated < options.max_tokens && !finished;) {
+        context[0] = prompt + response;
+        auto step = decode_step_locked(context, samplers);
+        for (const DecodedToken& token : step[0]) {
+            response += token.symbol;
+            finished = token.end_of_sequence || ++generated >= options.max_tokens;
+            if (finished) break;
+        }
     }
     
-    // Generate tokens
-    for (int i = 0; i < max_tokens; ++i) {
-        auto encoded = encode_input(prompt + response);
-        auto output = neural_net_->forward(encoded);
+    sessions_.record_turn(options.session_id, prompt, response, kResponseConfidence);
+    return response;
+}
+
+std::string LLMEngine::begin_generation(const std::string& prompt) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return begin_generation_locked(prompt);
+}
+
+void LLMEngine::end_generation(const std::string& prompt, const std::string& response,
+                               const std::string& session_id) {
+    sessions_.record_turn(session_id, prompt, response, kResponseConfidence);
+}
+
+std::vector<std::vector<DecodedToken>> LLMEngine::decode_step(const std::vector<std::string>& contexts,
+                                                               const std::vector<Sampler*>& samplers) {
+    BRAINLLM_TRACE_SCOPE("engine", "LLMEngine::decode_step");
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    ActiveRequest active(active_requests_);
+    return decode_step_locked(contexts, samplers);
+}
+
+Sampler LLMEngine::make_sampler(const GenerationOptions& options) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return Sampler(sampling_params_locked(options));
+}
+
+SamplingParams LLMEngine::sampling_params_locked(const GenerationOptions& options) const {
+    SamplingParams params;
+    params.temperature = options.temperature < 0.0f ? config_.temperature : options.temperature;
+    params.top_k = std::max(0, options.top_k);
+    params.top_p = options.top_p;
+    params.repetition_penalty = options.repetition_penalty;
+    params.seed = options.seed;
+    if (params.seed == 0) {
+        std::random_device entropy;
+        params.seed = (static_cast<uint64_t>(entropy()) << 32) | entropy();
+    }
+    return params;
+}
+
+std::string LLMEngine::begin_generation_locked(const std::string& prompt) {
+    uint64_t memory_version = memory_version_.load(std::memory_order_acquire);
+    std::string response;
+    if (!prefix_cache_.lookup_preamble(prompt, memory_version, response)) {
+        response = "AI Response: ";
         
-        float max_val = -1.0f;
-        size_t max_idx = 0;
-        for (size_t j = 0; j < output.size(); ++j) {
-            if (output[j] > max_val) {
-                max_val = output[j];
-                max_idx = j;
-            }
+        // Retrieve relevant memories
+        std::vector<MemoryRecord> memories;
+        {
+            std::lock_guard<std::mutex> memory_lock(memory_mutex_);
+            memories = memory_->retrieve_memories(prompt, 3);
         }
-        
-        response += char(32 + (max_idx % 94));
-        if (max_val < 0.3f) break;
+        if (!memories.empty()) {
+            response += "Based on memory: " + memories[0].content + ". ";
+        }
+        prefix_cache_.insert_preamble(prompt, memory_version, response);
     }
     
-    state_ = BrainState::Idle;
+    // Every decode step re-encodes prompt + response; with the prefix
+    // cached only the newly generated tail is tokenized
+    cache_prefix_tokens(prompt + response);
     return response;
 }
 
+void LLMEngine::cache_prefix_tokens(const std::string& text) {
+    // Keys run a few bytes past the cut so a match implies the same boundary
+    const size_t lookahead = BpeTokenizer::kBoundaryLookahead;
+    std::string_view view(text);
+    size_t stable = BpeTokenizer::stable_prefix_length(view.substr(0, view.size() - std::min(view.size(), lookahead)));
+    if (stable == 0) return;
+    
+    size_t key_length = stable + lookahead;
+    size_t shared = prefix_cache_.insert_tokens(view.substr(0, key_length), stable,
+                                                token_ids(view.substr(0, stable), SIZE_MAX));
+    
+    // The text branches off an earlier key partway through: give the common
+    // part its own entry so the next prompt with that opening reuses it
+    if (shared >= kMinSharedPrefix && shared < key_length) {
+        size_t branch = BpeTokenizer::stable_prefix_length(view.substr(0, shared - lookahead));
+        if (branch > 0) {
+            prefix_cache_.insert_tokens(view.substr(0, branch + lookahead), branch,
+                                        token_ids(view.substr(0, branch), SIZE_MAX));
+        }
+    }
+}
+
+std::vector<std::vector<DecodedToken>> LLMEngine::decode_step_locked(const std::vector<std::string>& contexts,
+                                                                      const std::vector<Sampler*>& samplers) {
+    if (draft_net_ && config_.speculative_tokens > 0) {
+        return speculative_step_locked(contexts, samplers);
+    }
+    
+    std::vector<Activation> encoded;
+    encoded.reserve(contexts.size());
+    for (const auto& context : contexts) {
+        encoded.push_back(encode_input(context));
+    }
+    
+    auto outputs = neural_net_->forward_batch(encoded);
+    
+    std::vector<std::vector<DecodedToken>> tokens(outputs.size());
+    runtime_metrics().tokens_generated.add(outputs.size());
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        const auto& output = outputs[i];
+        if (output.empty()) {
+            tokens[i].push_back({' ', 0.0f, true});
+            continue;
+        }
+        tokens[i].push_back(make_token(output, samplers[i]->sample(output)));
+    }
+    
+    return tokens;
+}
+
+std::vector<std::vector<DecodedToken>> LLMEngine::speculative_step_locked(const std::vector<std::string>& contexts,
+                                                                          const std::vector<Sampler*>& samplers) {
+    BRAINLLM_TRACE_SCOPE("engine", "LLMEngine::speculative_step");
+    size_t count = contexts.size();
+    size_t k = static_cast<size_t>(config_.speculative_tokens);
+    
+    // Draft: k cheap batched passes propose k tokens per context. Proposals
+    // go through each sampler's history so the repetition penalty sees them,
+    // and are rewound afterwards.
+    std::vector<std::string> drafted(count);
+    std::vector<std::vector<int>> proposed(count);
+    std::vector<std::vector<std::vector<float>>> draft_probabilities(count, std::vector<std::vector<float>>(k));
+    std::vector<size_t> history(count);
+    for (size_t i = 0; i < count; ++i) {
+        history[i] = samplers[i]->history_length();
+    }
+    
+    std::vector<Activation> encoded(count);
+    for (size_t j = 0; j < k; ++j) {
+        for (size_t i = 0; i < count; ++i) {
+            encoded[i] = encode_input(contexts[i] + drafted[i]);
+        }
+        auto outputs = draft_net_->forward_batch(encoded);
+        for (size_t i = 0; i < count; ++i) {
+            auto& probabilities = draft_probabilities[i][j];
+            samplers[i]->distribution(outputs[i].data(), outputs[i].size(), probabilities);
+            int index = samplers[i]->sample_from(probabilities);
+            samplers[i]->accept(index);
+            proposed[i].push_back(index);
+            drafted[i] += char(32 + (index % 94));
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        samplers[i]->rewind(history[i]);
+    }
+    
+    // Verify: one batched pass of the main network scores every prefix of
+    // every draft, k + 1 inputs per context
+    encoded.clear();
+    encoded.reserve(count * (k + 1));
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = 0; j <= k; ++j) {
+            encoded.push_back(encode_input(contexts[i] + drafted[i].substr(0, j)));
+        }
+    }
+    auto outputs = neural_net_->forward_batch(encoded);
+    
+    // Rejection sampling: draft token t is kept with probability
+    // min(1, p(t) / q(t)); the first rejection is replaced by a draw from
+    // max(0, p - q), and a fully accepted draft earns one more token from p.
+    // Every emitted token is therefore distributed exactly as p.
+    RuntimeMetrics& metrics = runtime_metrics();
+    std::vector<std::vector<DecodedToken>> tokens(count);
+    std::vector<float> target;
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Sampler& sampler = *samplers[i];
+        for (size_t j = 0; j <= k; ++j) {
+            const Activation& output = outputs[i * (k + 1) + j];
+            if (output.empty()) {
+                tokens[i].push_back({' ', 0.0f, true});
+                break;
+            }
+            sampler.distribution(output.data(), output.size(), target);
+            
+            if (j == k) {
+                int index = sampler.sample_from(target);
+                sampler.accept(index);
+                tokens[i].push_back(make_token(output, index));
+                break;
+            }
+            
+            int index = proposed[i][j];
+            const auto& draft = draft_probabilities[i][j];
+            if (sampler.uniform() * draft[index] < target[index]) {
+                ++accepted;
+                sampler.accept(index);
+                tokens[i].push_back(make_token(output, index));
+                if (tokens[i].back().end_of_sequence) break;
+                continue;
+            }
+            
+            ++rejected;
+            for (size_t v = 0; v < target.size(); ++v) {
+                target[v] = std::max(0.0f, target[v] - (v < draft.size() ? draft[v] : 0.0f));
+            }
+            index = sampler.sample_from(target);
+            sampler.accept(index);
+            tokens[i].push_back(make_token(output, index));
+            break;
+        }
+        metrics.tokens_generated.add(tokens[i].size());
+    }
+    metrics.speculative_accepted.add(accepted);
+    metrics.speculative_rejected.add(rejected);
+    
+    return tokens;
+}
+
 void LLMEngine::train(const std::vector<std::string>& training_data) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
     state_ = BrainState::Learning;
     
     for (const auto& data : training_data) {
         auto encoded = encode_input(data);
-        neural_net_->forward(encoded);
+        auto output = neural_net_->forward_training(encoded);
+        neural_net_->record_loss(output, encoded);
         neural_net_->backward(encoded);
         neural_net_->update_weights(config_.learning_rate);
+        
+        // The draft learns from the same data so its proposals keep
+        // tracking the main network
+        if (draft_net_) {
+            draft_net_->forward_training(encoded);
+            draft_net_->backward(encoded);
+            draft_net_->update_weights(config_.learning_rate);
+        }
+        finish_training_step_locked();
+    }
+    
+    model_version_.fetch_add(1, std::memory_order_release);
+    state_ = BrainState::Idle;
+}
+
+size_t LLMEngine::train(DataLoader& loader, size_t max_batches) {
+    BRAINLLM_TRACE_SCOPE("engine", "LLMEngine::train_stream");
+    TokenBatch batch;
+    size_t trained = 0;
+    
+    // The loader prepares the next batch while this one trains
+    while ((max_batches == 0 || trained < max_batches) && loader.next_batch(batch)) {
+        train_batch(batch);
+        ++trained;
+    }
+    return trained;
+}
+
+void LLMEngine::train_batch(const TokenBatch& batch) {
+    if (batch.count == 0) return;
+    
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    state_ = BrainState::Learning;
+    
+    std::vector<Activation> encoded;
+    encoded.reserve(batch.count);
+    for (size_t i = 0; i < batch.count; ++i) {
+        encoded.push_back(encode_tokens(batch.sequence(i), batch.sequence_length));
+    }
+    runtime_metrics().tokens_processed.add(batch.count * std::min(batch.sequence_length, encoded[0].size()));
+    
+    auto outputs = neural_net_->forward_training(encoded);
+    neural_net_->record_loss(outputs, encoded);
+    neural_net_->backward(encoded);
+    neural_net_->update_weights(config_.learning_rate);
+    if (draft_net_) {
+        draft_net_->forward_training(encoded);
+        draft_net_->backward(encoded);
+        draft_net_->update_weights(config_.learning_rate);
     }
+    finish_training_step_locked();
     
+    model_version_.fetch_add(1, std::memory_order_release);
     state_ = BrainState::Idle;
 }
 
+void LLMEngine::enable_checkpoints(const std::string& directory, size_t interval, size_t keep_last) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    checkpoints_ = std::make_unique<CheckpointWriter>(directory, keep_last);
+    checkpoint_interval_ = interval;
+}
+
+bool LLMEngine::save_checkpoint() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (!checkpoints_) return false;
+    snapshot_locked();
+    return true;
+}
+
+void LLMEngine::flush_checkpoints() {
+    // Snapshots are already staged, so waiting needs no model lock
+    CheckpointWriter* writer;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        writer = checkpoints_.get();
+    }
+    if (writer) writer->flush();
+}
+
+bool LLMEngine::load_checkpoint(const std::string& path) {
+    std::string file = path;
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error)) {
+        file = CheckpointWriter::find_latest(path);
+        if (file.empty()) return false;
+    }
+    
+    // Parse outside the lock; only the copy into the layers blocks requests
+    Checkpoint checkpoint;
+    if (!checkpoint.read(file)) return false;
+    
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (!neural_net_->load_weights("main", checkpoint)) return false;
+    
+    // A draft whose shape changed since the checkpoint keeps its weights
+    if (draft_net_) draft_net_->load_weights("draft", checkpoint);
+    training_steps_ = checkpoint.step;
+    model_version_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+uint64_t LLMEngine::get_training_steps() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return training_steps_;
+}
+
+void LLMEngine::finish_training_step_locked() {
+    size_t activation_bytes = neural_net_->get_activation_bytes();
+    if (draft_net_) activation_bytes += draft_net_->get_activation_bytes();
+    runtime_metrics().training_activation_bytes.set(static_cast<int64_t>(activation_bytes));
+    
+    ++training_steps_;
+    if (checkpoints_ && checkpoint_interval_ > 0 && training_steps_ % checkpoint_interval_ == 0) {
+        snapshot_locked();
+    }
+}
+
+void LLMEngine::record_weight_bytes_locked() {
+    size_t bytes = neural_net_->get_weight_bytes();
+    if (draft_net_) bytes += draft_net_->get_weight_bytes();
+    runtime_metrics().model_weight_bytes.set(static_cast<int64_t>(bytes));
+}
+
+void LLMEngine::snapshot_locked() {
+    BRAINLLM_TRACE_SCOPE("engine", "LLMEngine::snapshot");
+    // Copying into a recycled buffer is the only cost on the training
+    // thread; serialization and fsync happen on the writer's thread
+    Checkpoint checkpoint = checkpoints_->take_buffer();
+    checkpoint.step = training_steps_;
+    size_t next = 0;
+    neural_net_->save_weights("main", checkpoint.tensors, next);
+    if (draft_net_) draft_net_->save_weights("draft", checkpoint.tensors, next);
+    checkpoint.tensors.resize(next);
+    checkpoints_->submit(std::move(checkpoint));
+}
+
 void LLMEngine::update(const std::string& input, const std::string& expected_output) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
     auto encoded_input = encode_input(input);
     auto encoded_expected = encode_input(expected_output);
     
-    neural_net_->forward(encoded_input);
+    auto output = neural_net_->forward_training(encoded_input);
+    neural_net_->record_loss(output, encoded_expected);
     neural_net_->backward(encoded_expected);
     neural_net_->update_weights(config_.learning_rate);
+    if (draft_net_) {
+        draft_net_->forward_training(encoded_input);
+        draft_net_->backward(encoded_expected);
+        draft_net_->update_weights(config_.learning_rate);
+    }
+    finish_training_step_locked();
     
-    memory_->store_memory(input + " -> " + expected_output, 0.9f);
+    {
+        std::lock_guard<std::mutex> memory_lock(memory_mutex_);
+        memory_->store_memory(input + " -> " + expected_output, 0.9f);
+    }
+    model_version_.fetch_add(1, std::memory_order_release);
+    memory_version_.fetch_add(1, std::memory_order_release);
 }
 
 void LLMEngine::initialize() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::lock_guard<std::mutex> memory_lock(memory_mutex_);
     state_ = BrainState::Processing;
     neural_net_->initialize_weights();
+    if (draft_net_) draft_net_->initialize_weights();
     memory_->clear_memories();
+    training_steps_ = 0;
+    model_version_.fetch_add(1, std::memory_order_release);
+    memory_version_.fetch_add(1, std::memory_order_release);
     state_ = BrainState::Idle;
 }
 
 void LLMEngine::reset() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::lock_guard<std::mutex> memory_lock(memory_mutex_);
     state_ = BrainState::Idle;
     neural_net_->reset();
+    if (draft_net_) draft_net_->reset();
     memory_->clear_memories();
-    context_ = LanguageContext();
-    confidence_ = 0.0f;
+    sessions_.clear();
+    training_steps_ = 0;
+    model_version_.fetch_add(1, std::memory_order_release);
+    memory_version_.fetch_add(1, std::memory_order_release);
 }
 
 BrainState LLMEngine::get_state() const {
-    return state_;
+    BrainState state = state_.load();
+    if (state == BrainState::Idle && active_requests_.load(std::memory_order_relaxed) > 0) {
+        return BrainState::Processing;
+    }
+    return state;
 }
 
 void LLMEngine::set_state(BrainState state) {
@@ -109,56 +554,169 @@ void LLMEngine::set_state(BrainState state) {
 }
 
 BrainMetrics LLMEngine::get_metrics() const {
-    return neural_net_->get_metrics();
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    BrainMetrics metrics = neural_net_->get_metrics();
+    {
+        std::lock_guard<std::mutex> memory_lock(memory_mutex_);
+        metrics.memory_usage = memory_->get_memory_usage();
+    }
+    
+    std::lock_guard<std::mutex> sample_lock(metrics_mutex_);    
+    ProcessStats stats = read_process_stats();
+    uint64_t tokens_generated = runtime_metrics().tokens_generated.value();
+    double elapsed = stats.uptime_seconds - metrics_sample_.uptime_seconds;
+    if (elapsed > 0.0) {
+        double cores = std::max(1u, std::thread::hardware_concurrency());
+        double busy = (stats.cpu_seconds - metrics_sample_.cpu_seconds) / elapsed / cores;
+        metrics.cpu_usage = static_cast<float>(std::min(1.0, std::max(0.0, busy)));
+        metrics.processing_speed = static_cast<float>((tokens_generated - sampled_tokens_generated_) / elapsed);
+    }
+    metrics_sample_ = stats;
+    sampled_tokens_generated_ = tokens_generated;
+    
+    return metrics;
 }
 
-float LLMEngine::get_confidence() const {
-    return confidence_;
+float LLMEngine::get_confidence(const std::string& session_id) const {
+    float confidence = 0.0f;
+    sessions_.get_confidence(session_id, confidence);
+    return confidence;
 }
 
 void LLMEngine::update_config(const BrainConfig& config) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    bool draft_changed = (config.speculative_tokens > 0) != (config_.speculative_tokens > 0) ||
+                         config.draft_layers != config_.draft_layers;
     config_ = config;
+    neural_net_->set_checkpoint_interval(config_.activation_checkpoint_interval);
+    neural_net_->set_precision(config_.weight_precision);
+    if (draft_changed) {
+        draft_net_ = make_draft_network(config_);
+    } else if (draft_net_) {
+        draft_net_->set_checkpoint_interval(config_.activation_checkpoint_interval);
+        draft_net_->set_precision(config_.weight_precision);
+    }
+    record_weight_bytes_locked();
+    model_version_.fetch_add(1, std::memory_order_release);
 }
 
 BrainConfig LLMEngine::get_config() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
     return config_;
 }
 
-LanguageContext LLMEngine::get_context() const {
-    return context_;
+LanguageContext LLMEngine::get_context(const std::string& session_id) const {
+    LanguageContext context{};
+    sessions_.get_context(session_id, context);
+    return context;
+}
+
+void LLMEngine::set_context(const LanguageContext& context, const std::string& session_id) {
+    sessions_.set_context(session_id, context);
 }
 
-void LLMEngine::set_context(const LanguageContext& context) {
-    context_ = context;
+bool LLMEngine::get_session_history(const std::string& session_id, std::vector<DialogueTurn>& history) const {
+    return sessions_.get_history(session_id, history);
 }
 
-std::vector<MemoryRecord> LLMEngine::recall_memories(const std::string& query) {
-    return memory_->retrieve_memories(query);
+bool LLMEngine::close_session(const std::string& session_id) {
+    return sessions_.close(session_id);
+}
+
+std::vector<MemoryRecord> LLMEngine::recall_memories(const std::string& query, int count) {
+    std::lock_guard<std::mutex> lock(memory_mutex_);
+    return memory_->retrieve_memories(query, count);
+}
+
+std::vector<MemoryRecord> LLMEngine::recall_memories_by_category(const std::string& category) {
+    std::lock_guard<std::mutex> lock(memory_mutex_);
+    return memory_->get_memories_by_category(category);
 }
 
 void LLMEngine::store_interaction(const std::string& input, const std::string& output) {
-    memory_->store_memory(input + " | " + output, confidence_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    store_interaction_locked(input, output, get_confidence());
+}
+
+void LLMEngine::store_interaction_locked(const std::string& input, const std::string& output, float importance) {
+    std::lock_guard<std::mutex> memory_lock(memory_mutex_);
+    memory_->store_memory(input + " | " + output, importance);
+    memory_version_.fetch_add(1, std::memory_order_release);
+}
+
+void LLMEngine::store_interactions_locked(const std::vector<std::string>& inputs,
+                                          const std::vector<std::string>& outputs, float importance) {
+    // Entries are built before taking memory_mutex_ so the whole batch lands
+    // under one acquisition and one version bump
+    std::vector<std::string> contents;
+    contents.reserve(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        contents.push_back(inputs[i] + " | " + outputs[i]);
+    }
+    
+    std::lock_guard<std::mutex> memory_lock(memory_mutex_);
+    memory_->store_memories(std::move(contents), importance);
+    memory_version_.fetch_add(1, std::memory_order_release);
+}
+
+bool LLMEngine::load_tokenizer(const std::string& path) {
+    auto tokenizer = std::make_shared<BpeTokenizer>();
+    if (!tokenizer->load(path)) return false;
+    
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    tokenizer_ = std::move(tokenizer);
+    prefix_cache_.clear();
+    model_version_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+std::shared_ptr<const BpeTokenizer> LLMEngine::get_tokenizer() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return tokenizer_;
 }
 
-std::vector<float> LLMEngine::tokenize(const std::string& text) {
+std::vector<int> LLMEngine::token_ids(std::string_view text, size_t limit) {
+    // Cached prefixes end on stable tokenizer boundaries, so their ids
+    // followed by the ids of the rest equal the ids of the whole text
+    std::vector<int> ids;
+    size_t cached = prefix_cache_.match_tokens(text, ids);
+    if (ids.size() < limit && cached < text.size()) {
+        std::vector<int> rest = tokenizer_->encode(text.substr(cached));
+        ids.insert(ids.end(), rest.begin(), rest.end());
+    }
+    return ids;
+}
+
+std::vector<float> LLMEngine::tokenize(const std::string& text, size_t limit) {
+    // Token ids are scaled into [0, 1) so every vocabulary size feeds the
+    // network the same range
+    std::vector<int> ids = token_ids(text, limit);
+    float scale = 1.0f / static_cast<float>(tokenizer_->vocab_size());
+    
     std::vector<float> tokens;
-    for (char c : text) {
-        tokens.push_back(static_cast<float>(c) / 256.0f);
+    tokens.reserve(ids.size());
+    for (int id : ids) {
+        tokens.push_back(static_cast<float>(id) * scale);
     }
     return tokens;
 }
 
 std::string LLMEngine::detokenize(const std::vector<float>& tokens) {
-    std::string text;
+    int vocab = static_cast<int>(tokenizer_->vocab_size());
+    
+    std::vector<int> ids;
+    ids.reserve(tokens.size());
     for (float token : tokens) {
-        text += char(static_cast<int>(token * 256.0f));
+        int id = static_cast<int>(token * static_cast<float>(vocab));
+        ids.push_back(std::min(vocab - 1, std::max(0, id)));
     }
-    return text;
+    return tokenizer_->decode(ids);
 }
 
 Activation LLMEngine::encode_input(const std::string& input) {
     Activation activation(config_.embedding_dim, 0.0f);
-    auto tokens = tokenize(input);
+    auto tokens = tokenize(input, activation.size());
+    runtime_metrics().tokens_processed.add(std::min(tokens.size(), activation.size()));
     
     for (size_t i = 0; i < std::min(tokens.size(), activation.size()); ++i) {
         activation[i] = tokens[i];
@@ -167,6 +725,16 @@ Activation LLMEngine::encode_input(const std::string& input) {
     return activation;
 }
 
+Activation LLMEngine::encode_tokens(const int* ids, size_t count) const {
+    // Same scaling as tokenize(), straight from ids
+    Activation activation(config_.embedding_dim, 0.0f);
+    float scale = 1.0f / static_cast<float>(tokenizer_->vocab_size());
+    for (size_t i = 0; i < std::min(count, activation.size()); ++i) {
+        activation[i] = static_cast<float>(ids[i]) * scale;
+    }
+    return activation;
+}
+
 std::string LLMEngine::decode_output(const Activation& output) {
     std::vector<float> tokens(output.begin(), output.end());
     return detokenize(tokens);
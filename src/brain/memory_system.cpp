@@ -1,32 +1,54 @@
 #include "memory_system.h"
+#include "metrics.h"
+#include "trace.h"
 #include <algorithm>
 #include <chrono>
+#include <functional>
 
 namespace BrainLLM {
 
 MemorySystem::MemorySystem(int max_size)
-    : max_size_(max_size) {}
+    : next_id_(0), max_size_(max_size) {}
 
 void MemorySystem::store_memory(const std::string& content, float importance) {
+    append_entry(content, importance, current_timestamp());
+}
+
+void MemorySystem::store_memories(std::vector<std::string> contents, float importance) {
+    uint64_t timestamp = current_timestamp();
+    for (auto& content : contents) {
+        append_entry(std::move(content), importance, timestamp);
+    }
+}
+
+void MemorySystem::append_entry(std::string content, float importance, uint64_t timestamp) {
     if (memory_storage_.size() >= static_cast<size_t>(max_size_)) {
         remove_oldest();
     }
     
-    auto now = std::chrono::system_clock::now();
-    auto duration = now.time_since_epoch();
-    auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
-    
     MemoryEntry entry{};
-    entry.record.content = content;
+    entry.id = next_id_++;
+    entry.record.content = std::move(content);
     entry.record.importance = importance;
     entry.record.timestamp = timestamp;
     entry.record.category = "general";
     entry.last_accessed = timestamp;
     
-    memory_storage_.push_back(entry);
+    memory_storage_.push_back(std::move(entry));
+    index_entry(memory_storage_.back());
+}
+
+uint64_t MemorySystem::current_timestamp() {
+    auto duration = std::chrono::system_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(duration).count());
 }
 
 std::vector<MemoryRecord> MemorySystem::retrieve_memories(const std::string& query, int count) {
+    BRAINLLM_TRACE_SCOPE("memory", "MemorySystem::retrieve_memories");
+    RuntimeMetrics& metrics = runtime_metrics();
+    ScopedTimer timer(metrics.memory_retrieval_duration);
+    metrics.memory_retrievals.add();
+    
     std::vector<MemoryRecord> results;
     
     std::vector<std::pair<float, MemoryRecord>> scored;
@@ -47,6 +69,8 @@ std::vector<MemoryRecord> MemorySystem::retrieve_memories(const std::string& que
 
 void MemorySystem::clear_memories() {
     memory_storage_.clear();
+    category_index_.clear();
+    content_index_.clear();
 }
 
 int MemorySystem::get_memory_count() const {
@@ -83,26 +107,96 @@ void MemorySystem::decay_old_memories() {
 }
 
 void MemorySystem::categorize_memory(const std::string& content, const std::string& category) {
-    for (auto& entry : memory_storage_) {
-        if (entry.record.content == content) {
-            entry.record.category = category;
-            break;
+    // Match the oldest entry with identical content
+    MemoryEntry* target = nullptr;
+    auto range = content_index_.equal_range(std::hash<std::string>{}(content));
+    for (auto it = range.first; it != range.second; ++it) {
+        MemoryEntry* entry = find_entry(it->second);
+        if (entry && entry->record.content == content && (!target || entry->id < target->id)) {
+            target = entry;
+        }
+    }
+    
+    if (!target || target->record.category == category) return;
+    
+    auto old_bucket = category_index_.find(target->record.category);
+    if (old_bucket != category_index_.end()) {
+        old_bucket->second.erase(target->id);
+        if (old_bucket->second.empty()) {
+            category_index_.erase(old_bucket);
         }
     }
+    
+    target->record.category = category;
+    category_index_[category].insert(target->id);
 }
 
 std::vector<MemoryRecord> MemorySystem::get_memories_by_category(const std::string& category) {
     std::vector<MemoryRecord> results;
     
-    for (const auto& entry : memory_storage_) {
-        if (entry.record.category == category) {
-            results.push_back(entry.record);
+    for (const MemoryRecord* record : view_memories_by_category(category)) {
+        results.push_back(*record);
+    }
+    
+    return results;
+}
+
+std::vector<const MemoryRecord*> MemorySystem::view_memories_by_category(const std::string& category) const {
+    std::vector<const MemoryRecord*> results;
+    
+    auto bucket = category_index_.find(category);
+    if (bucket == category_index_.end()) return results;
+    
+    results.reserve(bucket->second.size());
+    for (uint64_t id : bucket->second) {
+        if (const MemoryEntry* entry = find_entry(id)) {
+            results.push_back(&entry->record);
         }
     }
     
     return results;
 }
 
+size_t MemorySystem::get_category_count(const std::string& category) const {
+    auto bucket = category_index_.find(category);
+    return bucket == category_index_.end() ? 0 : bucket->second.size();
+}
+
+MemorySystem::MemoryEntry* MemorySystem::find_entry(uint64_t id) {
+    if (memory_storage_.empty()) return nullptr;
+    
+    uint64_t front_id = memory_storage_.front().id;
+    if (id < front_id || id - front_id >= memory_storage_.size()) return nullptr;
+    return &memory_storage_[id - front_id];
+}
+
+const MemorySystem::MemoryEntry* MemorySystem::find_entry(uint64_t id) const {
+    return const_cast<MemorySystem*>(this)->find_entry(id);
+}
+
+void MemorySystem::index_entry(const MemoryEntry& entry) {
+    category_index_[entry.record.category].insert(entry.id);
+    content_index_.emplace(std::hash<std::string>{}(entry.record.content), entry.id);
+}
+
+void MemorySystem::unindex_entry(const MemoryEntry& entry) {
+    auto bucket = category_index_.find(entry.record.category);
+    if (bucket != category_index_.end()) {
+        bucket->second.erase(entry.id);
+        if (bucket->second.empty()) {
+            category_index_.erase(bucket);
+        }
+    }
+    
+    auto range = content_index_.equal_range(std::hash<std::string>{}(entry.record.content));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == entry.id) {
+            content_index_.erase(it);
+            break;
+        }
+    }
+}
+
 float MemorySystem::calculate_relevance(const std::string& memory, const std::string& query) const {
     if (query.empty()) return 0.0f;
     
@@ -125,6 +219,7 @@ float MemorySystem::calculate_relevance(const std::string& memory, const std::st
 
 void MemorySystem::remove_oldest() {
     if (!memory_storage_.empty()) {
+        unindex_entry(memory_storage_.front());
         memory_storage_.pop_front();
     }
 }
@@ -0,0 +1,350 @@
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define BRAINLLM_HAS_MALLINFO2 1
+#endif
+
+namespace BrainLLM {
+
+namespace {
+
+// Prometheus bucket boundaries in seconds; the HDR buckets are folded into these
+constexpr double kExportBounds[] = {
+    0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+    0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0
+};
+
+const auto kProcessStart = std::chrono::steady_clock::now();
+
+void append_sample(std::string& out, const std::string& name, const std::string& labels, double value) {
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.15g", value);
+    out += text;
+    out += '\n';
+}
+
+void append_header(std::string& out, const std::string& name, const std::string& help, const char* type) {
+    out += "# HELP " + name + " " + help + "\n";
+    out += "# TYPE " + name + " " + type + "\n";
+}
+
+} // namespace
+
+size_t metric_shard() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& slot : slots_) {
+        total += slot.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t Histogram::bucket_index(uint64_t value) {
+    if (value < kSubBuckets) return static_cast<size_t>(value);
+
+#ifdef _MSC_VER
+    unsigned long msb = 0;
+    _BitScanReverse64(&msb, value);
+    int exponent = static_cast<int>(msb);
+#else
+    int exponent = 63 - __builtin_clzll(value);
+#endif
+    if (exponent > kMaxExponent) return kBucketCount - 1;
+    
+    // The bits just below the leading one select the linear sub-bucket
+    uint64_t sub = (value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return static_cast<size_t>((exponent - kSubBucketBits + 1) * kSubBuckets + sub);
+}
+
+uint64_t Histogram::bucket_lower_bound(size_t index) {
+    if (index < kSubBuckets) return index;
+    
+    int exponent = static_cast<int>(index / kSubBuckets) + kSubBucketBits - 1;
+    uint64_t sub = index % kSubBuckets;
+    return (kSubBuckets + sub) << (exponent - kSubBucketBits);
+}
+
+uint64_t Histogram::bucket_upper_bound(size_t index) {
+    if (index < kSubBuckets) return index + 1;
+    
+    int exponent = static_cast<int>(index / kSubBuckets) + kSubBucketBits - 1;
+    return bucket_lower_bound(index) + (1ULL << (exponent - kSubBucketBits));
+}
+
+void Histogram::record(uint64_t value) {
+    Shard& shard = shards_[metric_shard() % kShards];
+    shard.buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot snapshot;
+    snapshot.buckets.assign(kBucketCount, 0);
+    
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            snapshot.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    
+    // Derive the count from the buckets so it is consistent with them
+    for (uint64_t bucket : snapshot.buckets) {
+        snapshot.count += bucket;
+    }
+    return snapshot;
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) return 0;
+    
+    q = std::min(1.0, std::max(0.0, q));
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count)));
+    
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            // Midpoint of the bucket halves the worst-case error
+            uint64_t lower = Histogram::bucket_lower_bound(i);
+            uint64_t upper = Histogram::bucket_upper_bound(i);
+            return lower + (upper - lower - 1) / 2;
+        }
+    }
+    return Histogram::bucket_lower_bound(buckets.size() - 1);
+}
+
+uint64_t HistogramSnapshot::count_at_or_below(uint64_t value) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        if (Histogram::bucket_upper_bound(i) - 1 > value) break;
+        total += buckets[i];
+    }
+    return total;
+}
+
+ScopedTimer::ScopedTimer(Histogram& histogram)
+    : histogram_(histogram), start_(monotonic_nanoseconds()) {}
+
+ScopedTimer::~ScopedTimer() {
+    histogram_.record(monotonic_nanoseconds() - start_);
+}
+
+uint64_t monotonic_nanoseconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+ProcessStats read_process_stats() {
+    ProcessStats stats;
+    stats.uptime_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - kProcessStart).count();
+
+#ifdef __linux__
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        stats.cpu_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                            usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+    
+    // Second field of statm is the resident set in pages
+    if (FILE* statm = std::fopen("/proc/self/statm", "r")) {
+        unsigned long size = 0;
+        unsigned long resident = 0;
+        if (std::fscanf(statm, "%lu %lu", &size, &resident) == 2) {
+            stats.resident_bytes = static_cast<uint64_t>(resident) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        }
+        std::fclose(statm);
+    }
+#endif
+
+#ifdef BRAINLLM_HAS_MALLINFO2
+    struct mallinfo2 info = mallinfo2();
+    stats.allocated_bytes = info.uordblks + info.hblkhd;
+#endif
+
+    return stats;
+}
+
+Counter& MetricsRegistry::add_counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.emplace_back();
+    entries_.push_back({Kind::Counter, name, help, labels, counters_.size() - 1});
+    return counters_.back();
+}
+
+Gauge& MetricsRegistry::add_gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gauges_.emplace_back();
+    entries_.push_back({Kind::Gauge, name, help, labels, gauges_.size() - 1});
+    return gauges_.back();
+}
+
+Histogram& MetricsRegistry::add_histogram(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    histograms_.emplace_back();
+    entries_.push_back({Kind::Histogram, name, help, std::string(), histograms_.size() - 1});
+    return histograms_.back();
+}
+
+void MetricsRegistry::write_prometheus(std::string& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    const std::string* previous_name = nullptr;
+    for (const auto& entry : entries_) {
+        // Labelled series of one family share a single HELP/TYPE header
+        bool new_family = !previous_name || *previous_name != entry.name;
+        previous_name = &entry.name;
+        
+        switch (entry.kind) {
+            case Kind::Counter:
+                if (new_family) append_header(out, entry.name, entry.help, "counter");
+                append_sample(out, entry.name, entry.labels, static_cast<double>(counters_[entry.index].value()));
+                break;
+            case Kind::Gauge:
+                if (new_family) append_header(out, entry.name, entry.help, "gauge");
+                append_sample(out, entry.name, entry.labels, static_cast<double>(gauges_[entry.index].value()));
+                break;
+            case Kind::Histogram: {
+                append_header(out, entry.name, entry.help, "histogram");
+                HistogramSnapshot snapshot = histograms_[entry.index].snapshot();
+                
+                char label[48];
+                for (double bound : kExportBounds) {
+                    std::snprintf(label, sizeof(label), "le=\"%g\"", bound);
+                    uint64_t at_or_below = snapshot.count_at_or_below(static_cast<uint64_t>(bound * 1e9));
+                    append_sample(out, entry.name + "_bucket", label, static_cast<double>(at_or_below));
+                }
+                append_sample(out, entry.name + "_bucket", "le=\"+Inf\"", static_cast<double>(snapshot.count));
+                append_sample(out, entry.name + "_sum", std::string(), snapshot.sum / 1e9);
+                append_sample(out, entry.name + "_count", std::string(), static_cast<double>(snapshot.count));
+                break;
+            }
+        }
+    }
+    
+    ProcessStats stats = read_process_stats();
+    append_header(out, "process_cpu_seconds_total", "Total user and system CPU time spent in seconds.", "counter");
+    append_sample(out, "process_cpu_seconds_total", std::string(), stats.cpu_seconds);
+    append_header(out, "process_resident_memory_bytes", "Resident memory size in bytes.", "gauge");
+    append_sample(out, "process_resident_memory_bytes", std::string(), static_cast<double>(stats.resident_bytes));
+    append_header(out, "brainllm_allocator_bytes_in_use", "Heap bytes currently allocated through malloc.", "gauge");
+    append_sample(out, "brainllm_allocator_bytes_in_use", std::string(), static_cast<double>(stats.allocated_bytes));
+    append_header(out, "brainllm_uptime_seconds", "Seconds since the process started.", "gauge");
+    append_sample(out, "brainllm_uptime_seconds", std::string(), stats.uptime_seconds);
+}
+
+RuntimeMetrics::RuntimeMetrics()
+    : requests_ok(registry.add_counter("brainllm_http_requests_total",
+                                       "API requests handled, by status class.", "code=\"2xx\"")),
+      requests_client_error(registry.add_counter("brainllm_http_requests_total",
+                                                 "API requests handled, by status class.", "code=\"4xx\"")),
+      requests_server_error(registry.add_counter("brainllm_http_requests_total",
+                                                 "API requests handled, by status class.", "code=\"5xx\"")),
+      request_duration(registry.add_histogram("brainllm_http_request_duration_seconds",
+                                              "Time spent handling an API request.")),
+      requests_unauthorized(registry.add_counter("brainllm_http_requests_rejected_total",
+                                                 "Requests refused before any work, by reason.",
+                                                 "reason=\"unauthorized\"")),
+      requests_rate_limited(registry.add_counter("brainllm_http_requests_rejected_total",
+                                                 "Requests refused before any work, by reason.",
+                                                 "reason=\"rate_limited\"")),
+      requests_shed(registry.add_counter("brainllm_http_requests_rejected_total",
+                                         "Requests refused before any work, by reason.", "reason=\"overloaded\"")),
+      connections_rejected(registry.add_counter("brainllm_http_connections_rejected_total",
+                                                "Connections refused at the connection cap.")),
+      request_queue_depth(registry.add_gauge("brainllm_http_request_queue_depth",
+                                             "Admitted requests waiting for a worker.")),
+      forward_passes(registry.add_counter("brainllm_forward_passes_total",
+                                          "Forward passes run through the network.")),
+      forward_inputs(registry.add_counter("brainllm_forward_inputs_total",
+                                          "Inputs evaluated by forward passes, counting each batch element.")),
+      forward_duration(registry.add_histogram("brainllm_forward_duration_seconds",
+                                              "Time spent in one (possibly batched) forward pass.")),
+      tokens_processed(registry.add_counter("brainllm_tokens_processed_total",
+                                            "Input tokens encoded for the network.")),
+      tokens_generated(registry.add_counter("brainllm_tokens_generated_total",
+                                            "Tokens produced by generation.")),
+      speculative_accepted(registry.add_counter("brainllm_speculative_draft_tokens_total",
+                                                "Draft tokens verified by the main network, by outcome.",
+                                                "result=\"accepted\"")),
+      speculative_rejected(registry.add_counter("brainllm_speculative_draft_tokens_total",
+                                                "Draft tokens verified by the main network, by outcome.",
+                                                "result=\"rejected\"")),
+      memory_retrievals(registry.add_counter("brainllm_memory_retrievals_total",
+                                             "Memory retrieval queries served.")),
+      memory_retrieval_duration(registry.add_histogram("brainllm_memory_retrieval_duration_seconds",
+                                                       "Time spent answering one memory retrieval.")),
+      decode_queue_depth(registry.add_gauge("brainllm_decode_queue_depth",
+                                            "Generation requests waiting for a decode slot.")),
+      decode_active_sequences(registry.add_gauge("brainllm_decode_active_sequences",
+                                                 "Sequences in the current decode batch.")),
+      response_cache_hits(registry.add_counter("brainllm_response_cache_requests_total",
+                                               "Response cache lookups, by result.", "result=\"hit\"")),
+      response_cache_misses(registry.add_counter("brainllm_response_cache_requests_total",
+                                                 "Response cache lookups, by result.", "result=\"miss\"")),
+      response_cache_evictions(registry.add_counter("brainllm_response_cache_evictions_total",
+                                                    "Entries evicted from the response cache.")),
+      response_cache_entries(registry.add_gauge("brainllm_response_cache_entries",
+                                                "Responses currently held in the response cache.")),
+      prefix_cache_hits(registry.add_counter("brainllm_prefix_cache_lookups_total",
+                                             "Prompt prefix cache lookups, by result.", "result=\"hit\"")),
+      prefix_cache_misses(registry.add_counter("brainllm_prefix_cache_lookups_total",
+                                               "Prompt prefix cache lookups, by result.", "result=\"miss\"")),
+      prefix_cache_bytes(registry.add_gauge("brainllm_prefix_cache_bytes",
+                                            "Estimated memory held by the prompt prefix cache.")),
+      sessions_allocated(registry.add_counter("brainllm_sessions_opened_total",
+                                              "Sessions opened, by where their state came from.",
+                                              "state=\"allocated\"")),
+      sessions_recycled(registry.add_counter("brainllm_sessions_opened_total",
+                                             "Sessions opened, by where their state came from.",
+                                             "state=\"recycled\"")),
+      sessions_evicted(registry.add_counter("brainllm_sessions_evicted_total",
+                                            "Sessions closed to make room or after sitting idle.")),
+      sessions_active(registry.add_gauge("brainllm_sessions_active",
+                                         "Sessions currently holding engine state.")),
+      checkpoints_written(registry.add_counter("brainllm_checkpoints_total",
+                                               "Training checkpoints, by outcome.", "result=\"written\"")),
+      checkpoints_superseded(registry.add_counter("brainllm_checkpoints_total",
+                                                  "Training checkpoints, by outcome.", "result=\"superseded\"")),
+      checkpoints_failed(registry.add_counter("brainllm_checkpoints_total",
+                                              "Training checkpoints, by outcome.", "result=\"failed\"")),
+      checkpoint_write_duration(registry.add_histogram("brainllm_checkpoint_write_duration_seconds",
+                                                       "Time to serialize, sync and rename one checkpoint.")),
+      training_activation_bytes(registry.add_gauge("brainllm_training_activation_bytes",
+                                                   "Activation memory held for backpropagation by the last training step.")),
+      model_weight_bytes(registry.add_gauge("brainllm_model_weight_bytes",
+                                            "Memory held by the main and draft network weights.")) {}
+
+RuntimeMetrics& runtime_metrics() {
+    static RuntimeMetrics metrics;
+    return metrics;
+}
+
+} // namespace BrainLLM
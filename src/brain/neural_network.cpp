@@ -1,56 +1,347 @@
 #include "neural_network.h"
+#include "metrics.h"
+#include "trace.h"
 #include <cmath>
 #include <algorithm>
 
 namespace BrainLLM {
 
+WeightMatrix::WeightMatrix(size_t rows, size_t cols, StoragePrecision precision)
+    : rows_(rows), cols_(cols), precision_(precision) {
+    // Pad rows to whole 64-byte lines so every row starts aligned
+    size_t per_line = 64 / storage_bytes(precision_);
+    stride_ = (cols_ + per_line - 1) / per_line * per_line;
+    if (precision_ == StoragePrecision::Float32) {
+        full_.assign(rows_ * stride_, 0.0f);
+    } else {
+        half_.assign(rows_ * stride_, 0);
+    }
+}
+
+size_t WeightMatrix::memory_bytes() const {
+    return full_.size() * sizeof(float) + half_.size() * sizeof(uint16_t);
+}
+
+const float* WeightMatrix::row(size_t j, float* buffer) const {
+    if (precision_ == StoragePrecision::Float32) {
+        return full_.data() + j * stride_;
+    }
+    widen_to_float(half_.data() + j * stride_, buffer, cols_, precision_);
+    return buffer;
+}
+
+float WeightMatrix::dot(size_t j, const float* x, size_t width) const {
+    if (precision_ != StoragePrecision::Float32) {
+        return dot_widened(half_.data() + j * stride_, x, width, precision_);
+    }
+    const float* row = full_.data() + j * stride_;
+    float sum = 0.0f;
+    for (size_t k = 0; k < width; ++k) {
+        sum += x[k] * row[k];
+    }
+    return sum;
+}
+
+void WeightMatrix::set_row(size_t j, const float* values) {
+    if (precision_ == StoragePrecision::Float32) {
+        std::copy(values, values + cols_, full_.data() + j * stride_);
+    } else {
+        narrow_from_float(values, half_.data() + j * stride_, cols_, precision_);
+    }
+}
+
+void WeightMatrix::subtract_scaled(size_t j, const float* gradient, float scale, float* buffer) {
+    if (precision_ == StoragePrecision::Float32) {
+        float* row = full_.data() + j * stride_;
+        for (size_t k = 0; k < cols_; ++k) {
+            row[k] -= scale * gradient[k];
+        }
+        return;
+    }
+    
+    widen_to_float(half_.data() + j * stride_, buffer, cols_, precision_);
+    for (size_t k = 0; k < cols_; ++k) {
+        buffer[k] -= scale * gradient[k];
+    }
+    narrow_from_float(buffer, half_.data() + j * stride_, cols_, precision_);
+}
+
+void WeightMatrix::fill_zero() {
+    // All-zero bits are +0 in every storage precision
+    std::fill(full_.begin(), full_.end(), 0.0f);
+    std::fill(half_.begin(), half_.end(), 0);
+}
+
 NeuralNetwork::NeuralNetwork(const BrainConfig& config)
-    : config_(config), rng_(std::random_device{}()) {
+    : config_(config), rng_(std::random_device{}()), last_loss_(-1.0f), checkpoint_interval_(1) {
+    for (int i = 0; i < config.num_layers; ++i) {
+        add_layer(config.neurons_per_layer);
+    }
     initialize_weights();
+    set_checkpoint_interval(config.activation_checkpoint_interval);
 }
 
 Activation NeuralNetwork::forward(const Activation& input) {
-    Activation current = input;
+    BRAINLLM_TRACE_SCOPE("network", "NeuralNetwork::forward");
+    RuntimeMetrics& metrics = runtime_metrics();
+    ScopedTimer timer(metrics.forward_duration);
+    metrics.forward_passes.add();
+    metrics.forward_inputs.add();
     
+    std::vector<Activation> current{input};
+    std::vector<Activation> next;
     for (size_t i = 0; i < layers_.size(); ++i) {
-        Activation next(layers_[i].size(), 0.0f);
-        
-        for (size_t j = 0; j < layers_[i].size(); ++j) {
+        apply_layer(i, current, next);
+        current.swap(next);
+    }
+    
+    return current[0];
+}
+
+std::vector<Activation> NeuralNetwork::forward_batch(const std::vector<Activation>& inputs) {
+    BRAINLLM_TRACE_SCOPE("network", "NeuralNetwork::forward_batch");
+    RuntimeMetrics& metrics = runtime_metrics();
+    ScopedTimer timer(metrics.forward_duration);
+    metrics.forward_passes.add();
+    metrics.forward_inputs.add(inputs.size());
+    
+    if (layers_.empty()) return inputs;
+    
+    std::vector<Activation> current;
+    std::vector<Activation> next;
+    apply_layer(0, inputs, current);
+    for (size_t i = 1; i < layers_.size(); ++i) {
+        apply_layer(i, current, next);
+        current.swap(next);
+    }
+    
+    return current;
+}
+
+void NeuralNetwork::apply_layer(size_t layer, const std::vector<Activation>& inputs,
+                                std::vector<Activation>& outputs) const {
+    const WeightMatrix& weights = layers_[layer];
+    bool last_layer = (layer == layers_.size() - 1);
+    outputs.resize(inputs.size());
+    for (auto& output : outputs) {
+        output.assign(weights.rows(), 0.0f);
+    }
+    
+    // Neuron-major order keeps one weight row hot in cache across the batch;
+    // inputs are taken four at a time so each weight is loaded once per group.
+    // Half-precision rows are widened once per batch; batches too small to
+    // amortize that, such as a single decode step, use the fused dot product.
+    size_t cols = weights.cols();
+    bool half = weights.precision() != StoragePrecision::Float32;
+    bool widen_rows = half && inputs.size() >= 4;
+    std::vector<float> widened(widen_rows ? cols : 0);
+    for (size_t j = 0; j < weights.rows(); ++j) {
+        const float* row = half && !widen_rows ? nullptr : weights.row(j, widened.data());
+        size_t b = 0;
+        for (; b + 4 <= inputs.size(); b += 4) {
+            const float* x0 = inputs[b].data();
+            const float* x1 = inputs[b + 1].data();
+            const float* x2 = inputs[b + 2].data();
+            const float* x3 = inputs[b + 3].data();
+            size_t width = std::min({cols, inputs[b].size(), inputs[b + 1].size(),
+                                     inputs[b + 2].size(), inputs[b + 3].size()});
+            float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+            for (size_t k = 0; k < width; ++k) {
+                float w = row[k];
+                sum0 += x0[k] * w;
+                sum1 += x1[k] * w;
+                sum2 += x2[k] * w;
+                sum3 += x3[k] * w;
+            }
+            outputs[b][j] = last_layer ? sigmoid(sum0) : relu(sum0);
+            outputs[b + 1][j] = last_layer ? sigmoid(sum1) : relu(sum1);
+            outputs[b + 2][j] = last_layer ? sigmoid(sum2) : relu(sum2);
+            outputs[b + 3][j] = last_layer ? sigmoid(sum3) : relu(sum3);
+        }
+        for (; b < inputs.size(); ++b) {
+            size_t width = std::min(inputs[b].size(), cols);
             float sum = 0.0f;
-            for (size_t k = 0; k < current.size(); ++k) {
-                sum += current[k] * layers_[i][j][k];
+            if (row) {
+                for (size_t k = 0; k < width; ++k) {
+                    sum += inputs[b][k] * row[k];
+                }
+            } else {
+                sum = weights.dot(j, inputs[b].data(), width);
             }
-            next[j] = (i < layers_.size() - 1) ? relu(sum) : sigmoid(sum);
+            outputs[b][j] = last_layer ? sigmoid(sum) : relu(sum);
         }
-        current = next;
     }
+}
+
+std::vector<Activation> NeuralNetwork::forward_training(const std::vector<Activation>& inputs) {
+    BRAINLLM_TRACE_SCOPE("network", "NeuralNetwork::forward_training");
+    size_t count = layers_.size();
+    saved_.resize(count + 1);
+    saved_[0] = inputs;
     
-    return current;
+    // Inputs to layers between checkpoints are dropped as soon as the next
+    // layer has consumed them; scratch_ alternates so a layer never writes
+    // the buffer it reads
+    const std::vector<Activation>* current = &saved_[0];
+    size_t parity = 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t produced = i + 1;
+        bool keep = produced == count || produced % checkpoint_interval_ == 0;
+        if (!keep) saved_[produced].clear();
+        std::vector<Activation>& output = keep ? saved_[produced] : scratch_[parity ^= 1];
+        apply_layer(i, *current, output);
+        current = &output;
+    }
+    return saved_[count];
+}
+
+Activation NeuralNetwork::forward_training(const Activation& input) {
+    return forward_training(std::vector<Activation>{input})[0];
 }
 
-void NeuralNetwork::backward(const Activation& gradient) {
-    // Simplified backpropagation
-    gradients_.assign(layers_.size(), NeuralLayer());
+void NeuralNetwork::backward(const std::vector<Activation>& targets) {
+    BRAINLLM_TRACE_SCOPE("network", "NeuralNetwork::backward");
+    size_t count = layers_.size();
+    if (count == 0 || saved_.size() != count + 1 || saved_[0].empty()) return;
     
-    for (size_t i = 0; i < layers_.size(); ++i) {
-        gradients_[i] = layers_[i];
+    // Gradients accumulate in fp32 whatever the weights are stored in
+    gradients_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        gradients_[i].resize(layers_[i].rows());
+        for (auto& row : gradients_[i]) {
+            row.assign(layers_[i].cols(), 0.0f);
+        }
+    }
+    
+    // Gradient of the batch mean of compute_loss() w.r.t. the outputs
+    const std::vector<Activation>& outputs = saved_[count];
+    size_t batch = std::min(outputs.size(), targets.size());
+    grad_.resize(outputs.size());
+    for (size_t b = 0; b < outputs.size(); ++b) {
+        grad_[b].assign(outputs[b].size(), 0.0f);
+        size_t width = b < batch ? std::min(outputs[b].size(), targets[b].size()) : 0;
+        if (width == 0) continue;
+        float scale = 2.0f / (static_cast<float>(width) * batch);
+        for (size_t k = 0; k < width; ++k) {
+            grad_[b][k] = scale * (outputs[b][k] - targets[b][k]);
+        }
+    }
+    
+    // Segments run from one kept input to the next, last segment first.
+    // Each one recomputes its dropped inputs from the kept input at its
+    // start, then propagates the gradient back through its layers.
+    size_t end = count;
+    while (end > 0) {
+        size_t begin = (end - 1) / checkpoint_interval_ * checkpoint_interval_;
+        segment_.resize(std::max<size_t>(segment_.size(), end - begin));
+        auto input_of = [&](size_t layer) -> const std::vector<Activation>& {
+            return layer == begin ? saved_[begin] : segment_[layer - begin];
+        };
+        for (size_t i = begin; i + 1 < end; ++i) {
+            apply_layer(i, input_of(i), segment_[i + 1 - begin]);
+        }
+        for (size_t i = end; i-- > begin;) {
+            backward_layer(i, input_of(i), i + 1 == end ? saved_[end] : segment_[i + 1 - begin]);
+        }
+        end = begin;
     }
 }
 
+void NeuralNetwork::backward(const Activation& target) {
+    backward(std::vector<Activation>{target});
+}
+
+void NeuralNetwork::backward_layer(size_t layer, const std::vector<Activation>& inputs,
+                                   const std::vector<Activation>& outputs) {
+    const WeightMatrix& weights = layers_[layer];
+    bool last_layer = (layer == layers_.size() - 1);
+    
+    // Through the activation: sigmoid' = y(1 - y), relu' = [y > 0]
+    for (size_t b = 0; b < grad_.size(); ++b) {
+        for (size_t j = 0; j < grad_[b].size(); ++j) {
+            float y = outputs[b][j];
+            grad_[b][j] *= last_layer ? y * (1.0f - y) : (y > 0.0f ? 1.0f : 0.0f);
+        }
+    }
+    
+    // The first layer's input gradient is never used
+    bool propagate = layer > 0;
+    grad_input_.resize(inputs.size());
+    for (size_t b = 0; b < inputs.size() && propagate; ++b) {
+        grad_input_[b].assign(inputs[b].size(), 0.0f);
+    }
+    
+    // Neuron-major, like apply_layer(), so each weight and gradient row is
+    // touched once per batch
+    size_t cols = weights.cols();
+    std::vector<float> widened(propagate && weights.precision() != StoragePrecision::Float32 ? cols : 0);
+    for (size_t j = 0; j < weights.rows(); ++j) {
+        const float* row = propagate ? weights.row(j, widened.data()) : nullptr;
+        auto& gradient = gradients_[layer][j];
+        for (size_t b = 0; b < inputs.size(); ++b) {
+            float delta = grad_[b][j];
+            if (delta == 0.0f) continue;
+            size_t width = std::min(inputs[b].size(), cols);
+            const float* x = inputs[b].data();
+            for (size_t k = 0; k < width; ++k) {
+                gradient[k] += delta * x[k];
+            }
+            if (propagate) {
+                float* dx = grad_input_[b].data();
+                for (size_t k = 0; k < width; ++k) {
+                    dx[k] += delta * row[k];
+                }
+            }
+        }
+    }
+    grad_.swap(grad_input_);
+}
+
+void NeuralNetwork::set_checkpoint_interval(int interval) {
+    size_t count = std::max<size_t>(1, layers_.size());
+    size_t resolved = interval > 0 ? static_cast<size_t>(interval)
+                                   : static_cast<size_t>(std::lround(std::sqrt(static_cast<double>(count))));
+    resolved = std::min(std::max<size_t>(1, resolved), count);
+    if (resolved == checkpoint_interval_) return;
+    
+    // Release buffers sized for the old policy so the saving is real
+    checkpoint_interval_ = resolved;
+    std::vector<std::vector<Activation>>().swap(saved_);
+    std::vector<std::vector<Activation>>().swap(segment_);
+}
+
+size_t NeuralNetwork::get_activation_bytes() const {
+    size_t floats = 0;
+    auto add = [&floats](const std::vector<Activation>& batch) {
+        for (const auto& activation : batch) floats += activation.capacity();
+    };
+    for (const auto& batch : saved_) add(batch);
+    for (const auto& batch : segment_) add(batch);
+    add(scratch_[0]);
+    add(scratch_[1]);
+    add(grad_);
+    add(grad_input_);
+    return floats * sizeof(float);
+}
+
 void NeuralNetwork::add_layer(int size) {
-    int prev_size = layers_.empty() ? config_.neurons_per_layer : layers_.back().size();
-    NeuralLayer layer(size, std::vector<float>(prev_size));
-    layers_.push_back(layer);
+    // The first layer reads the encoded input, which is embedding_dim wide
+    size_t prev_size = layers_.empty() ? static_cast<size_t>(std::max(0, config_.embedding_dim))
+                                       : layers_.back().rows();
+    layers_.emplace_back(static_cast<size_t>(std::max(0, size)), prev_size, config_.weight_precision);
 }
 
 void NeuralNetwork::initialize_weights() {
     std::normal_distribution<float> dist(0.0f, 0.1f);
+    std::vector<float> row;
     
     for (auto& layer : layers_) {
-        for (auto& neuron : layer) {
-            for (auto& weight : neuron) {
+        row.resize(layer.cols());
+        for (size_t j = 0; j < layer.rows(); ++j) {
+            for (auto& weight : row) {
                 weight = dist(rng_);
             }
+            layer.set_row(j, row.data());
         }
     }
 }
@@ -68,31 +359,117 @@ float NeuralNetwork::tanh_activation(float x) {
 }
 
 void NeuralNetwork::update_weights(float learning_rate) {
+    if (gradients_.size() != layers_.size()) return;  // No backward() yet
+    std::vector<float> buffer;
     for (size_t i = 0; i < layers_.size(); ++i) {
-        for (size_t j = 0; j < layers_[i].size(); ++j) {
-            for (size_t k = 0; k < layers_[i][j].size(); ++k) {
-                layers_[i][j][k] -= learning_rate * gradients_[i][j][k];
-            }
+        buffer.resize(layers_[i].cols());
+        for (size_t j = 0; j < layers_[i].rows(); ++j) {
+            layers_[i].subtract_scaled(j, gradients_[i][j].data(), learning_rate, buffer.data());
         }
     }
 }
 
+void NeuralNetwork::record_loss(const Activation& predicted, const Activation& expected) {
+    last_loss_ = compute_loss(predicted, expected);
+}
+
+void NeuralNetwork::record_loss(const std::vector<Activation>& predicted, const std::vector<Activation>& expected) {
+    size_t count = std::min(predicted.size(), expected.size());
+    if (count == 0) return;
+    
+    float total = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        total += compute_loss(predicted[i], expected[i]);
+    }
+    last_loss_ = total / count;
+}
+
+void NeuralNetwork::save_weights(const std::string& prefix, std::vector<CheckpointTensor>& tensors,
+                                 size_t& next) const {
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        if (next == tensors.size()) tensors.emplace_back();
+        CheckpointTensor& tensor = tensors[next++];
+        tensor.name = prefix + ".layer" + std::to_string(i);
+        tensor.rows = static_cast<uint32_t>(layers_[i].rows());
+        tensor.cols = static_cast<uint32_t>(layers_[i].cols());
+        tensor.data.resize(static_cast<size_t>(tensor.rows) * tensor.cols);
+        
+        // Half-precision rows widen straight into the tensor
+        float* out = tensor.data.data();
+        for (size_t j = 0; j < tensor.rows; ++j, out += tensor.cols) {
+            const float* row = layers_[i].row(j, out);
+            if (row != out) std::copy(row, row + tensor.cols, out);
+        }
+    }
+}
+
+bool NeuralNetwork::load_weights(const std::string& prefix, const Checkpoint& checkpoint) {
+    // Check every layer before touching any, so a mismatch changes nothing
+    std::vector<const CheckpointTensor*> found;
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        const CheckpointTensor* tensor = checkpoint.find(prefix + ".layer" + std::to_string(i));
+        if (!tensor || tensor->rows != layers_[i].rows() || tensor->cols != layers_[i].cols()) return false;
+        found.push_back(tensor);
+    }
+    
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        const float* in = found[i]->data.data();
+        for (size_t j = 0; j < layers_[i].rows(); ++j, in += layers_[i].cols()) {
+            layers_[i].set_row(j, in);
+        }
+    }
+    return true;
+}
+
+void NeuralNetwork::set_precision(StoragePrecision precision) {
+    if (precision == config_.weight_precision) return;
+    config_.weight_precision = precision;
+    
+    std::vector<float> buffer;
+    for (auto& layer : layers_) {
+        WeightMatrix converted(layer.rows(), layer.cols(), precision);
+        buffer.resize(layer.cols());
+        for (size_t j = 0; j < layer.rows(); ++j) {
+            converted.set_row(j, layer.row(j, buffer.data()));
+        }
+        layer = std::move(converted);
+    }
+}
+
+size_t NeuralNetwork::get_weight_bytes() const {
+    size_t bytes = 0;
+    for (const auto& layer : layers_) {
+        bytes += layer.memory_bytes();
+    }
+    return bytes;
+}
+
 BrainMetrics NeuralNetwork::get_metrics() const {
     BrainMetrics metrics{};
-    metrics.cpu_usage = 0.5f;
-    metrics.memory_usage = 0.3f;
-    metrics.processing_speed = 0.95f;
-    metrics.tokens_processed = 1000;
-    metrics.accuracy = 0.87f;
+    metrics.tokens_processed = runtime_metrics().tokens_processed.value();
+    
+    // Accuracy is reported as 1 - MSE of the most recent training step
+    metrics.accuracy = last_loss_ < 0.0f ? 0.0f : std::max(0.0f, 1.0f - last_loss_);
     return metrics;
 }
 
+float NeuralNetwork::compute_loss(const Activation& predicted, const Activation& expected) {
+    size_t width = std::min(predicted.size(), expected.size());
+    if (width == 0) return 0.0f;
+    
+    float sum = 0.0f;
+    for (size_t i = 0; i < width; ++i) {
+        float diff = predicted[i] - expected[i];
+        sum += diff * diff;
+    }
+    return sum / width;
+}
+
 void NeuralNetwork::reset() {
     for (auto& layer : layers_) {
-        for (auto& neuron : layer) {
-            std::fill(neuron.begin(), neuron.end(), 0.0f);
-        }
+        layer.fill_zero();
     }
+    last_loss_ = -1.0f;
 }
 
 } // namespace BrainLLM
@@ -0,0 +1,233 @@
+#include "prefix_cache.h"
+#include "metrics.h"
+#include <algorithm>
+
+namespace BrainLLM {
+
+PrefixCache::PrefixCache(size_t max_bytes) : max_bytes_(max_bytes), bytes_(0) {}
+
+size_t PrefixCache::node_bytes(const Node& node) {
+    return sizeof(Node) + node.edge.size() + node.tokens.size() * sizeof(int) + node.preamble.size();
+}
+
+size_t PrefixCache::match_tokens(std::string_view text, std::vector<int>& tokens) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Node* node = &root_;
+    Node* best = nullptr;
+    size_t best_length = 0;
+    size_t pos = 0;
+    
+    while (true) {
+        if (node->has_tokens) {
+            best = node;
+            best_length = node->covered;
+        }
+        if (pos == text.size()) break;
+        
+        auto child = node->children.find(text[pos]);
+        if (child == node->children.end()) break;
+        const std::string& edge = child->second->edge;
+        if (text.compare(pos, edge.size(), edge) != 0) break;
+        pos += edge.size();
+        node = child->second.get();
+    }
+    
+    if (!best) {
+        ++stats_.misses;
+        runtime_metrics().prefix_cache_misses.add();
+        return 0;
+    }
+    ++stats_.hits;
+    runtime_metrics().prefix_cache_hits.add();
+    touch(best);
+    tokens.insert(tokens.end(), best->tokens.begin(), best->tokens.end());
+    return best_length;
+}
+
+size_t PrefixCache::insert_tokens(std::string_view key, size_t covered, std::vector<int> tokens) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (covered == 0 || covered >= key.size() || key.size() + tokens.size() * sizeof(int) > max_bytes_ / 2) {
+        return 0;
+    }
+    
+    size_t shared = 0;
+    Node* node = insert_node(key, shared);
+    bytes_ -= node_bytes(*node);
+    node->tokens = std::move(tokens);
+    node->covered = covered;
+    node->has_tokens = true;
+    bytes_ += node_bytes(*node);
+    touch(node);
+    evict_to_budget(node);
+    return shared;
+}
+
+bool PrefixCache::lookup_preamble(std::string_view prompt, uint64_t memory_version, std::string& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Node* node = find_exact(prompt);
+    if (!node || !node->has_preamble || node->memory_version != memory_version) {
+        ++stats_.misses;
+        runtime_metrics().prefix_cache_misses.add();
+        return false;
+    }
+    ++stats_.hits;
+    runtime_metrics().prefix_cache_hits.add();
+    touch(node);
+    out.append(node->preamble);
+    return true;
+}
+
+void PrefixCache::insert_preamble(std::string_view prompt, uint64_t memory_version, std::string preamble) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (prompt.empty() || prompt.size() + preamble.size() > max_bytes_ / 2) return;
+    
+    size_t shared = 0;
+    Node* node = insert_node(prompt, shared);
+    bytes_ -= node_bytes(*node);
+    node->preamble = std::move(preamble);
+    node->memory_version = memory_version;
+    node->has_preamble = true;
+    bytes_ += node_bytes(*node);
+    touch(node);
+    evict_to_budget(node);
+}
+
+void PrefixCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    root_.children.clear();
+    lru_.clear();
+    bytes_ = 0;
+    runtime_metrics().prefix_cache_bytes.set(0);
+}
+
+PrefixCache::Stats PrefixCache::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.entries = lru_.size();
+    stats.bytes = bytes_;
+    return stats;
+}
+
+PrefixCache::Node* PrefixCache::find_exact(std::string_view key) {
+    Node* node = &root_;
+    size_t pos = 0;
+    while (pos < key.size()) {
+        auto child = node->children.find(key[pos]);
+        if (child == node->children.end()) return nullptr;
+        const std::string& edge = child->second->edge;
+        if (key.compare(pos, edge.size(), edge) != 0) return nullptr;
+        pos += edge.size();
+        node = child->second.get();
+    }
+    return node;
+}
+
+PrefixCache::Node* PrefixCache::insert_node(std::string_view key, size_t& shared) {
+    Node* node = &root_;
+    size_t pos = 0;
+    
+    while (pos < key.size()) {
+        auto slot = node->children.find(key[pos]);
+        if (slot == node->children.end()) {
+            auto leaf = std::make_unique<Node>();
+            leaf->edge = std::string(key.substr(pos));
+            leaf->parent = node;
+            bytes_ += node_bytes(*leaf);
+            Node* created = leaf.get();
+            node->children.emplace(key[pos], std::move(leaf));
+            shared = pos;
+            return created;
+        }
+        
+        Node* child = slot->second.get();
+        size_t limit = std::min(child->edge.size(), key.size() - pos);
+        size_t common = 0;
+        while (common < limit && child->edge[common] == key[pos + common]) {
+            ++common;
+        }
+        if (common == child->edge.size()) {
+            node = child;
+            pos += common;
+            continue;
+        }
+        
+        // Split the edge where the key leaves it
+        auto middle = std::make_unique<Node>();
+        middle->edge = child->edge.substr(0, common);
+        middle->parent = node;
+        bytes_ -= node_bytes(*child);
+        child->edge.erase(0, common);
+        child->parent = middle.get();
+        bytes_ += node_bytes(*child) + node_bytes(*middle);
+        
+        Node* split = middle.get();
+        middle->children.emplace(child->edge[0], std::move(slot->second));
+        slot->second = std::move(middle);
+        node = split;
+        pos += common;
+    }
+    
+    shared = key.size();
+    return node;
+}
+
+void PrefixCache::touch(Node* node) {
+    if (node->in_lru) {
+        lru_.splice(lru_.begin(), lru_, node->lru);
+    } else {
+        lru_.push_front(node);
+        node->lru = lru_.begin();
+        node->in_lru = true;
+    }
+    runtime_metrics().prefix_cache_bytes.set(static_cast<int64_t>(bytes_));
+}
+
+void PrefixCache::drop_data(Node* node) {
+    bytes_ -= node_bytes(*node);
+    node->has_tokens = false;
+    std::vector<int>().swap(node->tokens);
+    node->has_preamble = false;
+    std::string().swap(node->preamble);
+    bytes_ += node_bytes(*node);
+    
+    if (node->in_lru) {
+        lru_.erase(node->lru);
+        node->in_lru = false;
+    }
+    prune(node);
+}
+
+void PrefixCache::prune(Node* node) {
+    while (node != &root_ && !node->has_tokens && !node->has_preamble) {
+        Node* parent = node->parent;
+        char key = node->edge[0];
+        
+        if (node->children.empty()) {
+            bytes_ -= node_bytes(*node);
+            parent->children.erase(key);
+            node = parent;
+            continue;
+        }
+        
+        // A pass-through node with one child folds into that child
+        if (node->children.size() == 1) {
+            std::unique_ptr<Node> child = std::move(node->children.begin()->second);
+            bytes_ -= node_bytes(*node) + node_bytes(*child);
+            child->edge = node->edge + child->edge;
+            child->parent = parent;
+            bytes_ += node_bytes(*child);
+            parent->children[key] = std::move(child);
+        }
+        break;
+    }
+}
+
+void PrefixCache::evict_to_budget(const Node* keep) {
+    while (bytes_ > max_bytes_ && !lru_.empty() && lru_.back() != keep) {
+        drop_data(lru_.back());
+        ++stats_.evictions;
+    }
+    runtime_metrics().prefix_cache_bytes.set(static_cast<int64_t>(bytes_));
+}
+
+} // namespace BrainLLM
@@ -0,0 +1,181 @@
+#include "sampler.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace BrainLLM {
+
+Sampler::Sampler(const SamplingParams& params) : params_(params), rng_(params.seed) {}
+
+int Sampler::sample(const float* logits, size_t count) {
+    if (count == 0) return 0;
+    
+    float total = 0.0f;
+    size_t kept = prepare(logits, count, total);
+    
+    float target = uniform() * total;
+    int token = candidates_[kept - 1];  // Rounding can leave target just past the last mass
+    for (size_t i = 0; i < kept; ++i) {
+        target -= scores_[candidates_[i]];
+        if (target < 0.0f) {
+            token = candidates_[i];
+            break;
+        }
+    }
+    
+    remember(token);
+    return token;
+}
+
+void Sampler::distribution(const float* logits, size_t count, std::vector<float>& out) {
+    out.assign(count, 0.0f);
+    if (count == 0) return;
+    
+    float total = 0.0f;
+    size_t kept = prepare(logits, count, total);
+    float scale = 1.0f / total;
+    for (size_t i = 0; i < kept; ++i) {
+        out[candidates_[i]] = scores_[candidates_[i]] * scale;
+    }
+}
+
+int Sampler::sample_from(const std::vector<float>& weights) {
+    float total = 0.0f;
+    int last = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        if (weights[i] > 0.0f) {
+            total += weights[i];
+            last = static_cast<int>(i);
+        }
+    }
+    
+    float target = uniform() * total;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        if (weights[i] <= 0.0f) continue;
+        target -= weights[i];
+        if (target < 0.0f) return static_cast<int>(i);
+    }
+    return last;
+}
+
+float Sampler::uniform() {
+    return std::uniform_real_distribution<float>(0.0f, 1.0f)(rng_);
+}
+
+void Sampler::rewind(size_t length) {
+    if (length >= history_.size()) return;
+    history_.resize(length);
+    while (!first_seen_.empty() && first_seen_.back() >= length) {
+        seen_[distinct_.back()] = 0;
+        distinct_.pop_back();
+        first_seen_.pop_back();
+    }
+}
+
+size_t Sampler::prepare(const float* logits, size_t count, float& total) {
+    scores_.assign(logits, logits + count);
+    apply_repetition_penalty(count);
+    
+    if (params_.temperature <= 0.0f || params_.top_k == 1) {
+        candidates_.assign(1, argmax(count));
+        scores_[candidates_[0]] = 1.0f;
+        total = 1.0f;
+        return 1;
+    }
+    
+    // Plain loop over contiguous floats so the compiler vectorizes it
+    float inverse_temperature = 1.0f / params_.temperature;
+    float* scores = scores_.data();
+    for (size_t i = 0; i < count; ++i) {
+        scores[i] *= inverse_temperature;
+    }
+    
+    size_t candidates = select_top_k(count);
+    
+    // Softmax over the candidates, written back over their scores
+    float max_score = scores[candidates_[0]];
+    for (size_t i = 1; i < candidates; ++i) {
+        max_score = std::max(max_score, scores[candidates_[i]]);
+    }
+    total = 0.0f;
+    for (size_t i = 0; i < candidates; ++i) {
+        float probability = std::exp(scores[candidates_[i]] - max_score);
+        scores[candidates_[i]] = probability;
+        total += probability;
+    }
+    
+    if (params_.top_p >= 1.0f) return candidates;
+    
+    size_t kept = select_nucleus(candidates, total);
+    total = 0.0f;
+    for (size_t i = 0; i < kept; ++i) {
+        total += scores[candidates_[i]];
+    }
+    return kept;
+}
+
+void Sampler::apply_repetition_penalty(size_t count) {
+    if (params_.repetition_penalty == 1.0f) return;
+    
+    // Dividing a positive logit and multiplying a negative one both make
+    // the token less likely
+    for (int token : distinct_) {
+        if (static_cast<size_t>(token) >= count) continue;
+        float& score = scores_[token];
+        score = score > 0.0f ? score / params_.repetition_penalty : score * params_.repetition_penalty;
+    }
+}
+
+int Sampler::argmax(size_t count) const {
+    return static_cast<int>(std::max_element(scores_.begin(), scores_.begin() + count) - scores_.begin());
+}
+
+size_t Sampler::select_top_k(size_t count) {
+    candidates_.resize(count);
+    std::iota(candidates_.begin(), candidates_.end(), 0);
+    
+    size_t k = params_.top_k > 0 ? std::min(count, static_cast<size_t>(params_.top_k)) : count;
+    if (k < count) {
+        // Linear-time selection: the k best end up in front, unordered
+        const float* scores = scores_.data();
+        std::nth_element(candidates_.begin(), candidates_.begin() + (k - 1), candidates_.end(),
+                         [scores](int a, int b) { return scores[a] > scores[b]; });
+    }
+    return k;
+}
+
+size_t Sampler::select_nucleus(size_t candidates, float total) {
+    const float* scores = scores_.data();
+    auto more_likely = [scores](int a, int b) { return scores[a] > scores[b]; };
+    float target = std::max(0.0f, params_.top_p) * total;
+    
+    // The nucleus is usually a few dozen tokens, so sort a small prefix and
+    // only widen it when that prefix does not yet hold enough mass
+    size_t sorted = std::min(candidates, kNucleusBatch);
+    while (true) {
+        std::partial_sort(candidates_.begin(), candidates_.begin() + sorted,
+                          candidates_.begin() + candidates, more_likely);
+        
+        float mass = 0.0f;
+        for (size_t i = 0; i < sorted; ++i) {
+            mass += scores[candidates_[i]];
+            if (mass >= target) return i + 1;
+        }
+        if (sorted == candidates) return candidates;
+        sorted = std::min(candidates, sorted * 4);
+    }
+}
+
+void Sampler::remember(int token) {
+    history_.push_back(token);
+    
+    size_t index = static_cast<size_t>(token);
+    if (index >= seen_.size()) seen_.resize(index + 1, 0);
+    if (!seen_[index]) {
+        seen_[index] = 1;
+        distinct_.push_back(token);
+        first_seen_.push_back(history_.size() - 1);
+    }
+}
+
+} // namespace BrainLLM
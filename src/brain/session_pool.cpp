@@ -0,0 +1,180 @@
+#include "session_pool.h"
+#include "metrics.h"
+#include <algorithm>
+
+namespace BrainLLM {
+
+void SessionState::add_turn(const std::string& input, const std::string& output) {
+    size_t slot = turn_count % kMaxTurns;
+    if (slot >= turns.size()) {
+        turns.emplace_back();
+    }
+    turns[slot].input.assign(input);
+    turns[slot].output.assign(output);
+    ++turn_count;
+}
+
+std::vector<DialogueTurn> SessionState::history() const {
+    size_t stored = static_cast<size_t>(std::min<uint64_t>(turn_count, kMaxTurns));
+    size_t oldest = turn_count < kMaxTurns ? 0 : turn_count % kMaxTurns;
+    
+    std::vector<DialogueTurn> ordered;
+    ordered.reserve(stored);
+    for (size_t i = 0; i < stored; ++i) {
+        ordered.push_back(turns[(oldest + i) % kMaxTurns]);
+    }
+    return ordered;
+}
+
+void SessionState::reset() {
+    id.clear();
+    context.embeddings.clear();
+    context.current_input.clear();
+    context.last_output.clear();
+    context.confidence = 0.0f;
+    confidence = 0.0f;
+    turn_count = 0;
+    for (DialogueTurn& turn : turns) {
+        turn.input.clear();
+        turn.output.clear();
+    }
+}
+
+SessionPool::SessionPool(size_t max_sessions, std::chrono::seconds idle_timeout, size_t max_free)
+    : max_sessions_(std::max<size_t>(1, max_sessions)), idle_timeout_(idle_timeout), max_free_(max_free) {}
+
+void SessionPool::record_turn(const std::string& id, const std::string& input, const std::string& output,
+                              float confidence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SessionState& state = open(id);
+    state.context.current_input.assign(input);
+    state.context.last_output.assign(output);
+    state.context.confidence = confidence;
+    state.confidence = confidence;
+    state.add_turn(input, output);
+}
+
+void SessionPool::set_context(const std::string& id, const LanguageContext& context) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open(id).context = context;
+}
+
+bool SessionPool::get_context(const std::string& id, LanguageContext& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const SessionState* state = find(id);
+    if (!state) return false;
+    out = state->context;
+    return true;
+}
+
+bool SessionPool::get_confidence(const std::string& id, float& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const SessionState* state = find(id);
+    if (!state) return false;
+    out = state->confidence;
+    return true;
+}
+
+bool SessionPool::get_history(const std::string& id, std::vector<DialogueTurn>& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const SessionState* state = find(id);
+    if (!state) return false;
+    out = state->history();
+    return true;
+}
+
+bool SessionPool::close(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sessions_.find(id) == sessions_.end()) return false;
+    recycle(id);
+    return true;
+}
+
+void SessionPool::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!lru_.empty()) {
+        recycle(*lru_.back());
+    }
+}
+
+SessionPool::Stats SessionPool::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.active = sessions_.size();
+    stats.free = free_.size();
+    return stats;
+}
+
+SessionState& SessionPool::open(const std::string& id) {
+    auto now = std::chrono::steady_clock::now();
+    auto existing = sessions_.find(id);
+    if (existing != sessions_.end()) {
+        Entry& entry = existing->second;
+        lru_.splice(lru_.begin(), lru_, entry.lru);
+        entry.state->last_used = now;
+        return *entry.state;
+    }
+    
+    // Make room before creating, so the pool never exceeds its cap
+    RuntimeMetrics& metrics = runtime_metrics();
+    expire_idle(now);
+    if (sessions_.size() >= max_sessions_) {
+        recycle(*lru_.back());
+        ++stats_.evicted;
+        metrics.sessions_evicted.add();
+    }
+    
+    std::unique_ptr<SessionState> state;
+    if (!free_.empty()) {
+        state = std::move(free_.back());
+        free_.pop_back();
+        ++stats_.recycled;
+        metrics.sessions_recycled.add();
+    } else {
+        state = std::make_unique<SessionState>();
+        metrics.sessions_allocated.add();
+    }
+    ++stats_.created;
+    state->id = id;
+    state->last_used = now;
+    
+    auto inserted = sessions_.emplace(id, Entry{std::move(state), lru_.end()}).first;
+    lru_.push_front(&inserted->first);
+    inserted->second.lru = lru_.begin();
+    metrics.sessions_active.add(1);
+    return *inserted->second.state;
+}
+
+const SessionState* SessionPool::find(const std::string& id) const {
+    auto existing = sessions_.find(id);
+    return existing == sessions_.end() ? nullptr : existing->second.state.get();
+}
+
+void SessionPool::expire_idle(std::chrono::steady_clock::time_point now) {
+    if (idle_timeout_.count() <= 0) return;
+    
+    // The least recently used session sits at the back, so stop at the
+    // first one used within the timeout
+    while (!lru_.empty()) {
+        const SessionState& oldest = *sessions_.find(*lru_.back())->second.state;
+        if (now - oldest.last_used < idle_timeout_) break;
+        recycle(oldest.id);
+        ++stats_.evicted;
+        runtime_metrics().sessions_evicted.add();
+    }
+}
+
+void SessionPool::recycle(const std::string& id) {
+    auto existing = sessions_.find(id);
+    Entry entry = std::move(existing->second);
+    lru_.erase(entry.lru);
+    sessions_.erase(existing);
+    runtime_metrics().sessions_active.add(-1);
+    
+    if (free_.size() < max_free_) {
+        entry.state->reset();
+        free_.push_back(std::move(entry.state));
+    }
+}
+
+} // namespace BrainLLM
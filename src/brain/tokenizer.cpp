@@ -0,0 +1,250 @@
+#include "tokenizer.h"
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <sstream>
+
+namespace BrainLLM {
+
+namespace {
+
+constexpr const char* kVocabHeader = "brainllm-bpe 1";
+
+enum class CharClass {
+    Letter,
+    Digit,
+    Space,
+    Other
+};
+
+CharClass classify(unsigned char c) {
+    // Bytes of multi-byte UTF-8 sequences count as letters so words in
+    // other scripts stay in one piece
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80) return CharClass::Letter;
+    if (c >= '0' && c <= '9') return CharClass::Digit;
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') return CharClass::Space;
+    return CharClass::Other;
+}
+
+} // namespace
+
+BpeTokenizer::BpeTokenizer() {
+    reset();
+}
+
+void BpeTokenizer::reset() {
+    merges_.clear();
+    merge_ranks_.clear();
+    token_bytes_.clear();
+    token_bytes_.reserve(kByteTokens);
+    for (int byte = 0; byte < kByteTokens; ++byte) {
+        token_bytes_.emplace_back(1, static_cast<char>(byte));
+    }
+}
+
+void BpeTokenizer::add_merge(int left, int right) {
+    merge_ranks_.emplace(pair_key(left, right), static_cast<int>(merges_.size()));
+    merges_.push_back({left, right});
+    token_bytes_.push_back(token_bytes_[left] + token_bytes_[right]);
+}
+
+std::vector<std::string_view> BpeTokenizer::pre_tokenize(std::string_view text) {
+    std::vector<std::string_view> pieces;
+    size_t i = 0;
+    while (i < text.size()) {
+        size_t start = i;
+        CharClass kind = classify(static_cast<unsigned char>(text[i]));
+        
+        // A single space joins the word, number or punctuation after it
+        if (text[i] == ' ' && i + 1 < text.size() &&
+            classify(static_cast<unsigned char>(text[i + 1])) != CharClass::Space) {
+            ++i;
+            kind = classify(static_cast<unsigned char>(text[i]));
+        }
+        
+        while (i < text.size() && classify(static_cast<unsigned char>(text[i])) == kind) {
+            ++i;
+        }
+        
+        // Leave the last space of a whitespace run to the word that follows
+        if (kind == CharClass::Space && i < text.size() && i - start > 1 && text[i - 1] == ' ') {
+            --i;
+        }
+        pieces.push_back(text.substr(start, i - start));
+    }
+    return pieces;
+}
+
+size_t BpeTokenizer::stable_prefix_length(std::string_view text) {
+    std::vector<std::string_view> pieces = pre_tokenize(text);
+    if (pieces.size() < 2) return 0;
+    return static_cast<size_t>(pieces.back().data() - text.data());
+}
+
+void BpeTokenizer::train(const std::vector<std::string>& corpus, size_t vocab_size) {
+    reset();
+    
+    std::unordered_map<std::string_view, uint64_t> piece_counts;
+    for (const auto& text : corpus) {
+        for (std::string_view piece : pre_tokenize(text)) {
+            ++piece_counts[piece];
+        }
+    }
+    
+    struct Word {
+        std::vector<int> symbols;
+        uint64_t count;
+    };
+    std::vector<Word> words;
+    words.reserve(piece_counts.size());
+    for (const auto& entry : piece_counts) {
+        Word word{{}, entry.second};
+        for (char c : entry.first) {
+            word.symbols.push_back(static_cast<unsigned char>(c));
+        }
+        if (word.symbols.size() > 1) words.push_back(std::move(word));
+    }
+    
+    std::unordered_map<uint64_t, uint64_t> pair_counts;
+    while (this->vocab_size() < vocab_size) {
+        pair_counts.clear();
+        for (const auto& word : words) {
+            for (size_t i = 0; i + 1 < word.symbols.size(); ++i) {
+                pair_counts[pair_key(word.symbols[i], word.symbols[i + 1])] += word.count;
+            }
+        }
+        
+        // Most frequent pair; ties go to the smaller key so training is deterministic
+        uint64_t best_key = 0;
+        uint64_t best_count = 0;
+        for (const auto& entry : pair_counts) {
+            if (entry.second > best_count || (entry.second == best_count && entry.first < best_key)) {
+                best_key = entry.first;
+                best_count = entry.second;
+            }
+        }
+        if (best_count < 2) break;
+        
+        int left = static_cast<int>(best_key >> 32);
+        int right = static_cast<int>(best_key & 0xffffffffu);
+        int merged = static_cast<int>(this->vocab_size());
+        add_merge(left, right);
+        
+        for (auto& word : words) {
+            auto& symbols = word.symbols;
+            size_t out = 0;
+            for (size_t i = 0; i < symbols.size(); ++i) {
+                if (i + 1 < symbols.size() && symbols[i] == left && symbols[i + 1] == right) {
+                    symbols[out++] = merged;
+                    ++i;
+                } else {
+                    symbols[out++] = symbols[i];
+                }
+            }
+            symbols.resize(out);
+        }
+        
+        // Words reduced to one symbol can no longer contribute pairs
+        words.erase(std::remove_if(words.begin(), words.end(),
+                                   [](const Word& word) { return word.symbols.size() < 2; }),
+                    words.end());
+    }
+}
+
+bool BpeTokenizer::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return false;
+    
+    std::string line;
+    if (!std::getline(file, line) || line != kVocabHeader) return false;
+    
+    BpeTokenizer loaded;
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+        std::istringstream fields(line);
+        int left = -1;
+        int right = -1;
+        if (!(fields >> left >> right)) return false;
+        
+        // A merge may only refer to tokens defined before it
+        int defined = static_cast<int>(loaded.vocab_size());
+        if (left < 0 || right < 0 || left >= defined || right >= defined) return false;
+        loaded.add_merge(left, right);
+    }
+    
+    *this = std::move(loaded);
+    return true;
+}
+
+bool BpeTokenizer::save(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) return false;
+    
+    file << kVocabHeader << '\n';
+    for (const auto& merge : merges_) {
+        file << merge.left << ' ' << merge.right << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+void BpeTokenizer::encode_piece(std::string_view piece, std::vector<int>& out) const {
+    if (piece.size() == 1 || merges_.empty()) {
+        for (char c : piece) {
+            out.push_back(static_cast<unsigned char>(c));
+        }
+        return;
+    }
+    
+    size_t first = out.size();
+    for (char c : piece) {
+        out.push_back(static_cast<unsigned char>(c));
+    }
+    
+    // Repeatedly apply the lowest-ranked merge present; this replays the
+    // training order, so the result matches what training produced
+    while (out.size() - first > 1) {
+        int best_rank = INT_MAX;
+        size_t best_index = 0;
+        for (size_t i = first; i + 1 < out.size(); ++i) {
+            auto found = merge_ranks_.find(pair_key(out[i], out[i + 1]));
+            if (found != merge_ranks_.end() && found->second < best_rank) {
+                best_rank = found->second;
+                best_index = i;
+            }
+        }
+        if (best_rank == INT_MAX) break;
+        
+        out[best_index] = kByteTokens + best_rank;
+        out.erase(out.begin() + static_cast<std::ptrdiff_t>(best_index) + 1);
+    }
+}
+
+std::vector<int> BpeTokenizer::encode(std::string_view text) const {
+    std::vector<int> tokens;
+    tokens.reserve(text.size() / 3 + 1);
+    for (std::string_view piece : pre_tokenize(text)) {
+        encode_piece(piece, tokens);
+    }
+    return tokens;
+}
+
+std::vector<std::vector<int>> BpeTokenizer::encode_batch(const std::vector<std::string>& texts) const {
+    std::vector<std::vector<int>> batch;
+    batch.reserve(texts.size());
+    for (const auto& text : texts) {
+        batch.push_back(encode(text));
+    }
+    return batch;
+}
+
+std::string BpeTokenizer::decode(const std::vector<int>& tokens) const {
+    std::string text;
+    for (int token : tokens) {
+        if (token >= 0 && static_cast<size_t>(token) < token_bytes_.size()) {
+            text += token_bytes_[token];
+        }
+    }
+    return text;
+}
+
+} // namespace BrainLLM
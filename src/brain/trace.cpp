@@ -0,0 +1,195 @@
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define BRAINLLM_TRACE_TSC 1
+#endif
+
+namespace BrainLLM {
+
+namespace {
+
+uint64_t steady_nanoseconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void append_json_string(std::string& out, const char* text) {
+    out += '"';
+    for (const char* p = text ? text : ""; *p; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            out += escape;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer()
+    : enabled_(false), cleared_ticks_(0), epoch_ticks_(now_ticks()), epoch_ns_(steady_nanoseconds()) {}
+
+uint64_t Tracer::now_ticks() {
+#ifdef BRAINLLM_TRACE_TSC
+    return __rdtsc();
+#else
+    return steady_nanoseconds();
+#endif
+}
+
+double Tracer::ticks_per_microsecond() const {
+#ifdef BRAINLLM_TRACE_TSC
+    // Calibrate the TSC against steady_clock over the tracer's lifetime
+    uint64_t ticks = now_ticks() - epoch_ticks_;
+    uint64_t ns = steady_nanoseconds() - epoch_ns_;
+    if (ns == 0 || ticks == 0) return 1000.0;
+    return static_cast<double>(ticks) * 1000.0 / static_cast<double>(ns);
+#else
+    return 1000.0;
+#endif
+}
+
+Tracer::ThreadBuffer& Tracer::local_buffer() {
+    thread_local BufferLease lease;
+    if (!lease.buffer) {
+        // Buffers outlive their threads so finished threads' events survive,
+        // and are reused by new threads so pools that recycle workers do not
+        // grow the trace without bound; a reused buffer keeps its thread id
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (!free_buffers_.empty()) {
+            lease.buffer = free_buffers_.back();
+            free_buffers_.pop_back();
+        } else {
+            auto created = std::make_unique<ThreadBuffer>();
+            created->thread_id = static_cast<uint32_t>(buffers_.size() + 1);
+            lease.buffer = created.get();
+            buffers_.push_back(std::move(created));
+        }
+    }
+    return *lease.buffer;
+}
+
+void Tracer::release_buffer(ThreadBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    free_buffers_.push_back(buffer);
+}
+
+Tracer::BufferLease::~BufferLease() {
+    if (buffer) {
+        Tracer::instance().release_buffer(buffer);
+    }
+}
+
+void Tracer::record(const char* category, const char* name, uint64_t start_ticks, uint64_t end_ticks) {
+    ThreadBuffer& buffer = local_buffer();
+    uint64_t index = buffer.head.load(std::memory_order_relaxed);
+    Slot& slot = buffer.events[index % kEventsPerThread];
+    
+    // Odd sequence marks the slot as being written
+    uint64_t sequence = 2 * index + 1;
+    slot.sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start_ticks, std::memory_order_relaxed);
+    slot.end.store(end_ticks, std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_release);
+    
+    buffer.head.store(index + 1, std::memory_order_release);
+}
+
+std::vector<TraceEvent> Tracer::collect() const {
+    std::vector<TraceEvent> events;
+    double ticks_per_us = ticks_per_microsecond();
+    uint64_t cleared = cleared_ticks_.load(std::memory_order_relaxed);
+    
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (const auto& buffer : buffers_) {
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first = head > kEventsPerThread ? head - kEventsPerThread : 0;
+        
+        for (uint64_t index = first; index < head; ++index) {
+            const Slot& slot = buffer->events[index % kEventsPerThread];
+            uint64_t expected = 2 * index + 2;
+            if (slot.sequence.load(std::memory_order_acquire) != expected) continue;
+            
+            const char* category = slot.category.load(std::memory_order_relaxed);
+            const char* name = slot.name.load(std::memory_order_relaxed);
+            uint64_t start = slot.start.load(std::memory_order_relaxed);
+            uint64_t end = slot.end.load(std::memory_order_relaxed);
+            
+            // Discard the copy if the writer lapped us while we were reading
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != expected) continue;
+            if (start < cleared || start < epoch_ticks_) continue;
+            
+            events.push_back({category, name, buffer->thread_id,
+                              static_cast<double>(start - epoch_ticks_) / ticks_per_us,
+                              static_cast<double>(end - start) / ticks_per_us});
+        }
+    }
+    
+    std::sort(events.begin(), events.end(),
+              [](const TraceEvent& a, const TraceEvent& b) { return a.start_us < b.start_us; });
+    return events;
+}
+
+void Tracer::clear() {
+    cleared_ticks_.store(now_ticks(), std::memory_order_relaxed);
+}
+
+std::string Tracer::chrome_trace_json() const {
+    std::vector<TraceEvent> events = collect();
+    
+    std::string out;
+    out.reserve(64 + events.size() * 96);
+    out += "{\"traceEvents\":[";
+    
+    char numbers[96];
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent& event = events[i];
+        if (i > 0) out += ',';
+        out += "{\"name\":";
+        append_json_string(out, event.name);
+        out += ",\"cat\":";
+        append_json_string(out, event.category);
+        std::snprintf(numbers, sizeof(numbers), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                      event.start_us, event.duration_us, event.thread_id);
+        out += numbers;
+    }
+    
+    out += "],\"displayTimeUnit\":\"ms\"}";
+    return out;
+}
+
+bool Tracer::write_chrome_trace(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    
+    std::string json = chrome_trace_json();
+    file.write(json.data(), static_cast<std::streamsize>(json.size()));
+    return static_cast<bool>(file);
+}
+
+} // namespace BrainLLM
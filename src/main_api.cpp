@@ -1,31 +1,118 @@
 #include <iostream>
-#include <thread>
-#include <chrono>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <QCoreApplication>
 #include "llm_engine.h"
 #include "rest_server.h"
 #include "config_manager.h"
+#include "request_handler.h"
+#include "trace.h"
+#ifdef BRAINLLM_HAS_EPOLL_SERVER
+#include "epoll_server.h"
+#endif
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Command line: --epoll selects the native front end, --threads N sets its
+    // event loops and --workers N the threads that run requests for them,
+    // --trace starts with tracing enabled (dump it from GET /debug/trace),
+    // --tokenizer FILE loads a BPE vocabulary written by train_tokenizer,
+    // --precision fp32|fp16|bf16 selects the weight storage type,
+    // --config FILE reads settings from FILE instead of ./config.ini
+    bool use_epoll = false;
+    int epoll_threads = 0;
+    int epoll_workers = 0;
+    const char* tokenizer_path = nullptr;
+    const char* precision_name = nullptr;
+    const char* config_path = "config.ini";
+    bool explicit_config = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--epoll") == 0) {
+            use_epoll = true;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            epoll_threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            epoll_workers = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--trace") == 0) {
+            BrainLLM::Tracer::instance().set_enabled(true);
+        } else if (std::strcmp(argv[i], "--tokenizer") == 0 && i + 1 < argc) {
+            tokenizer_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--precision") == 0 && i + 1 < argc) {
+            precision_name = argv[++i];
+        } else if (std::strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            config_path = argv[++i];
+            explicit_config = true;
+        }
+    }
+    
+    // RestServer's sockets and worker results are driven by the Qt event loop
+    QCoreApplication app(argc, argv);
+    
     std::cout << "=== BrainLLM API Server ===" << std::endl;
     std::cout << "Initializing AI Brain Engine..." << std::endl;
     
-    // Load configuration
+    // Load configuration; without a config file the built-in defaults apply
     BrainLLM::ConfigManager config_manager;
+    if ((explicit_config || std::ifstream(config_path).good()) && !config_manager.load_config(config_path)) {
+        std::cerr << "Failed to load configuration from " << config_path << std::endl;
+        return 1;
+    }
     auto brain_config = config_manager.get_brain_config();
     auto api_config = config_manager.get_api_settings();
+    if (precision_name && !BrainLLM::parse_storage_precision(precision_name, brain_config.weight_precision)) {
+        std::cerr << "Unknown weight precision " << precision_name << " (expected fp32, fp16 or bf16)" << std::endl;
+        return 1;
+    }
     
     // Initialize LLM Engine
     auto llm_engine = std::make_shared<BrainLLM::LLMEngine>(brain_config);
     llm_engine->initialize();
     
+    if (tokenizer_path) {
+        if (!llm_engine->load_tokenizer(tokenizer_path)) {
+            std::cerr << "Failed to load tokenizer from " << tokenizer_path << std::endl;
+            return 1;
+        }
+        std::cout << "Loaded BPE tokenizer with " << llm_engine->get_tokenizer()->vocab_size()
+                  << " tokens" << std::endl;
+    }
+    
     std::cout << "LLM Engine initialized with " << brain_config.num_layers 
-              << " layers and " << brain_config.neurons_per_layer << " neurons per layer" << std::endl;
+              << " layers and " << brain_config.neurons_per_layer << " neurons per layer ("
+              << BrainLLM::storage_name(brain_config.weight_precision) << " weights)" << std::endl;
+
+#ifdef BRAINLLM_HAS_EPOLL_SERVER
+    std::unique_ptr<BrainLLM::EpollServer> epoll_server;
+#else
+    if (use_epoll) {
+        std::cerr << "Native epoll front end is not available in this build" << std::endl;
+        return 1;
+    }
+#endif
+    std::shared_ptr<BrainLLM::RestServer> api_server;
+    bool started = false;
     
-    // Start REST API Server
-    auto api_server = std::make_shared<BrainLLM::RestServer>(api_config.port);
-    api_server->set_llm_engine(llm_engine);
+    if (use_epoll) {
+#ifdef BRAINLLM_HAS_EPOLL_SERVER
+        auto handler = std::make_shared<BrainLLM::RequestHandler>(llm_engine);
+        epoll_server = std::make_unique<BrainLLM::EpollServer>(handler, api_config.port, epoll_threads,
+                                                               epoll_workers);
+        epoll_server->set_api_settings(api_config);
+        started = epoll_server->start();
+        if (started) {
+            std::cout << "Native epoll front end running " << epoll_server->get_thread_count()
+                      << " event loops and " << epoll_server->get_worker_count() << " workers" << std::endl;
+        }
+#endif
+    } else {
+        // Start REST API Server
+        api_server = std::make_shared<BrainLLM::RestServer>(api_config.port);
+        api_server->set_llm_engine(llm_engine);
+        api_server->set_api_settings(api_config);
+        started = api_server->start();
+    }
     
-    if (api_server->start()) {
+    if (started) {
         std::cout << "API Server started on " << api_config.host << ":" 
                   << api_config.port << std::endl;
     } else {
@@ -35,23 +122,20 @@ int main() {
     
     std::cout << "\nAvailable endpoints:" << std::endl;
     std::cout << "  POST   /api/process    - Process input text" << std::endl;
+    std::cout << "  POST   /api/process_batch - Process an array of inputs in one pass" << std::endl;
     std::cout << "  POST   /api/generate   - Generate response from prompt" << std::endl;
     std::cout << "  GET    /api/status     - Get brain status and metrics" << std::endl;
     std::cout << "  GET    /api/memory     - Query memory" << std::endl;
+    std::cout << "  GET    /api/memory/category/{name} - List memories in a category" << std::endl;
     std::cout << "  GET    /api/config     - Get current configuration" << std::endl;
+    std::cout << "  GET    /api/session/{id} - Get a session's history and confidence" << std::endl;
+    std::cout << "  DELETE /api/session/{id} - Close a session and release its state" << std::endl;
     std::cout << "  POST   /api/train      - Train the model" << std::endl;
+    std::cout << "  GET    /metrics        - Prometheus metrics" << std::endl;
+    std::cout << "  GET    /debug/trace    - Chrome trace of recent requests" << std::endl;
+    std::cout << "  POST   /debug/trace    - Enable, disable or clear tracing" << std::endl;
     
     std::cout << "\nServer running... Press Ctrl+C to stop" << std::endl;
     
-    // Keep server running
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        
-        // Periodic memory decay
-        if (std::rand() % 100 == 0) {
-            // Simulate memory operations
-        }
-    }
-    
-    return 0;
+    return app.exec();
 }
@@ -1,9 +1,56 @@
 #include "config_manager.h"
+#include <cerrno>
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
 
 namespace BrainLLM {
 
+namespace {
+
+std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return std::string();
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+bool parse_value(const std::string& text, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || errno != 0) return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+bool parse_value(const std::string& text, float& value) {
+    char* end = nullptr;
+    errno = 0;
+    float parsed = std::strtof(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || errno != 0) return false;
+    value = parsed;
+    return true;
+}
+
+bool parse_value(const std::string& text, bool& value) {
+    if (text == "true" || text == "1") {
+        value = true;
+    } else if (text == "false" || text == "0") {
+        value = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_value(const std::string& text, std::string& value) {
+    value = text;
+    return true;
+}
+
+} // namespace
+
 ConfigManager::ConfigManager()
     : brain_config_(default_brain_config()),
       ui_settings_(default_ui_settings()),
@@ -18,7 +65,13 @@ bool ConfigManager::load_config(const std::string& filepath) {
     
     std::stringstream buffer;
     buffer << file.rdbuf();
-    return parse_json(buffer.str());
+    std::string content = buffer.str();
+    
+    size_t first = content.find_first_not_of(" \t\r\n");
+    if (first != std::string::npos && content[first] == '{') {
+        return parse_json(content);
+    }
+    return parse_ini(content);
 }
 
 bool ConfigManager::save_config(const std::string& filepath) {
@@ -76,7 +129,11 @@ BrainConfig ConfigManager::default_brain_config() {
         768,         // embedding_dim
         1024,        // context_length
         32,          // batch_size
-        0.7f         // temperature
+        0.7f,        // temperature
+        0,           // speculative_tokens
+        2,           // draft_layers
+        1,           // activation_checkpoint_interval
+        StoragePrecision::Float32  // weight_precision
     };
 }
 
@@ -97,7 +154,11 @@ ConfigManager::APISettings ConfigManager::default_api_settings() {
         8080,        // port
         true,        // enable_cors
         100,         // max_connections
-        ""           // api_key
+        "",          // api_key
+        0.0f,        // requests_per_second
+        20,          // burst
+        256,         // max_queued_requests
+        5000         // request_deadline_ms
     };
 }
 
@@ -106,6 +167,82 @@ bool ConfigManager::parse_json(const std::string& json_content) {
     return !json_content.empty();
 }
 
+bool ConfigManager::parse_ini(const std::string& ini_content) {
+    std::istringstream lines(ini_content);
+    std::string line;
+    std::string section;
+    bool valid = true;
+    
+    while (std::getline(lines, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
+        
+        if (line.front() == '[' && line.back() == ']') {
+            section = trim(line.substr(1, line.size() - 2));
+            continue;
+        }
+        
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            valid = false;
+            continue;
+        }
+        if (!apply_setting(section, trim(line.substr(0, eq)), trim(line.substr(eq + 1)))) {
+            valid = false;
+        }
+    }
+    
+    return valid;
+}
+
+bool ConfigManager::apply_setting(const std::string& section, const std::string& key, const std::string& value) {
+    if (section == "brain") {
+        BrainConfig& brain = brain_config_;
+        if (key == "num_layers") return parse_value(value, brain.num_layers);
+        if (key == "neurons_per_layer") return parse_value(value, brain.neurons_per_layer);
+        if (key == "learning_rate") return parse_value(value, brain.learning_rate);
+        if (key == "max_memory_size") return parse_value(value, brain.max_memory_size);
+        if (key == "memory_decay_rate") return parse_value(value, brain.memory_decay_rate);
+        if (key == "num_attention_heads") return parse_value(value, brain.num_attention_heads);
+        if (key == "attention_dim") return parse_value(value, brain.attention_dim);
+        if (key == "vocab_size") return parse_value(value, brain.vocab_size);
+        if (key == "embedding_dim") return parse_value(value, brain.embedding_dim);
+        if (key == "context_length") return parse_value(value, brain.context_length);
+        if (key == "batch_size") return parse_value(value, brain.batch_size);
+        if (key == "temperature") return parse_value(value, brain.temperature);
+        if (key == "speculative_tokens") return parse_value(value, brain.speculative_tokens);
+        if (key == "draft_layers") return parse_value(value, brain.draft_layers);
+        if (key == "activation_checkpoint_interval") {
+            return parse_value(value, brain.activation_checkpoint_interval);
+        }
+        if (key == "weight_precision") return parse_storage_precision(value, brain.weight_precision);
+    } else if (section == "ui") {
+        UISettings& ui = ui_settings_;
+        if (key == "dark_mode") return parse_value(value, ui.dark_mode);
+        if (key == "window_width") return parse_value(value, ui.window_width);
+        if (key == "window_height") return parse_value(value, ui.window_height);
+        if (key == "maximize_on_start") return parse_value(value, ui.maximize_on_start);
+        if (key == "font_size") return parse_value(value, ui.font_size);
+        if (key == "theme") return parse_value(value, ui.theme);
+    } else if (section == "api") {
+        APISettings& api = api_settings_;
+        if (key == "host") return parse_value(value, api.host);
+        if (key == "port") return parse_value(value, api.port);
+        if (key == "enable_cors") return parse_value(value, api.enable_cors);
+        if (key == "max_connections") return parse_value(value, api.max_connections);
+        if (key == "api_key") return parse_value(value, api.api_key);
+        if (key == "requests_per_second") return parse_value(value, api.requests_per_second);
+        if (key == "burst") return parse_value(value, api.burst);
+        if (key == "max_queued_requests") return parse_value(value, api.max_queued_requests);
+        if (key == "request_deadline_ms") return parse_value(value, api.request_deadline_ms);
+    } else if (section == "logging") {
+        if (key == "log_level") return parse_value(value, log_level_);
+    }
+    
+    // Keys this build does not use are not an error
+    return true;
+}
+
 std::string ConfigManager::to_json() const {
     std::stringstream ss;
     ss << "{\n";
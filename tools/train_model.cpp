@@ -0,0 +1,155 @@
+// train_model - streams text or JSONL corpora through LLMEngine training.
+//
+//   train_model [--tokenizer FILE] [--jsonl] [--field NAME] [--batch-size N]
+//               [--sequence-length N] [--threads N] [--shuffle-window N]
+//               [--max-batches N] [--seed N] [--repeat] [--checkpoint-dir DIR]
+//               [--checkpoint-every N] [--keep N] [--resume]
+//               [--activation-checkpoint N] [--config FILE] CORPUS...
+//
+// Corpora are memory-mapped and tokenized on background threads, so they
+// may be far larger than RAM. The sequence length defaults to the
+// configured embedding width, which is what the network sees per input.
+// With --checkpoint-dir, weights are written every N batches on a
+// background thread and once more at the end; --resume starts from the
+// newest checkpoint in the directory. --activation-checkpoint N keeps only
+// every Nth layer's activations for backpropagation (0 picks about
+// sqrt(layers)), trading recomputation for memory on deep networks.
+// Settings come from ./config.ini when it exists, or from --config FILE;
+// the flags above override them.
+
+#include "config_manager.h"
+#include "data_loader.h"
+#include "llm_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    // The config file is read before the other flags so they can override it
+    const char* config_path = "config.ini";
+    bool explicit_config = false;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--config") == 0) {
+            config_path = argv[i + 1];
+            explicit_config = true;
+        }
+    }
+    
+    BrainLLM::ConfigManager config_manager;
+    if ((explicit_config || std::ifstream(config_path).good()) && !config_manager.load_config(config_path)) {
+        std::cerr << "Failed to load configuration from " << config_path << std::endl;
+        return 1;
+    }
+    BrainLLM::BrainConfig config = config_manager.get_brain_config();
+    
+    BrainLLM::DataLoaderOptions options;
+    options.sequence_length = static_cast<size_t>(config.embedding_dim);
+    const char* tokenizer_path = nullptr;
+    size_t max_batches = 0;
+    const char* checkpoint_dir = nullptr;
+    size_t checkpoint_every = 1000;
+    size_t keep_checkpoints = 3;
+    bool resume = false;
+    for (int i = 1; i < argc; ++i) {
+        auto count = [&]() { return static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10)); };
+        if (std::strcmp(argv[i], "--tokenizer") == 0 && i + 1 < argc) {
+            tokenizer_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--jsonl") == 0) {
+            options.format = BrainLLM::CorpusFormat::JsonLines;
+        } else if (std::strcmp(argv[i], "--field") == 0 && i + 1 < argc) {
+            options.text_field = argv[++i];
+        } else if (std::strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc) {
+            options.batch_size = count();
+        } else if (std::strcmp(argv[i], "--sequence-length") == 0 && i + 1 < argc) {
+            options.sequence_length = count();
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.worker_threads = count();
+        } else if (std::strcmp(argv[i], "--shuffle-window") == 0 && i + 1 < argc) {
+            options.shuffle_window = count();
+        } else if (std::strcmp(argv[i], "--max-batches") == 0 && i + 1 < argc) {
+            max_batches = count();
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = count();
+        } else if (std::strcmp(argv[i], "--repeat") == 0) {
+            options.repeat = true;
+        } else if (std::strcmp(argv[i], "--checkpoint-dir") == 0 && i + 1 < argc) {
+            checkpoint_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) {
+            checkpoint_every = count();
+        } else if (std::strcmp(argv[i], "--keep") == 0 && i + 1 < argc) {
+            keep_checkpoints = count();
+        } else if (std::strcmp(argv[i], "--resume") == 0) {
+            resume = true;
+        } else if (std::strcmp(argv[i], "--activation-checkpoint") == 0 && i + 1 < argc) {
+            config.activation_checkpoint_interval = static_cast<int>(count());
+        } else if (std::strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            ++i;  // Already loaded above
+        } else {
+            options.paths.push_back(argv[i]);
+        }
+    }
+    if (options.paths.empty()) {
+        std::cerr << "Usage: train_model [--tokenizer FILE] [--jsonl] [--field NAME] [--batch-size N]\n"
+                  << "                   [--sequence-length N] [--threads N] [--shuffle-window N]\n"
+                  << "                   [--max-batches N] [--seed N] [--repeat] [--checkpoint-dir DIR]\n"
+                  << "                   [--checkpoint-every N] [--keep N] [--resume]\n"
+                  << "                   [--activation-checkpoint N] [--config FILE] CORPUS..." << std::endl;
+        return 1;
+    }
+    
+    BrainLLM::LLMEngine engine(config);
+    engine.initialize();
+    if (tokenizer_path && !engine.load_tokenizer(tokenizer_path)) {
+        std::cerr << "Failed to load tokenizer from " << tokenizer_path << std::endl;
+        return 1;
+    }
+    if (checkpoint_dir) {
+        if (resume && BrainLLM::CheckpointWriter::find_latest(checkpoint_dir).empty()) {
+            std::cout << "No checkpoint in " << checkpoint_dir << ", starting fresh" << std::endl;
+        } else if (resume && !engine.load_checkpoint(checkpoint_dir)) {
+            std::cerr << "Failed to resume from " << checkpoint_dir << std::endl;
+            return 1;
+        } else if (resume) {
+            std::cout << "Resumed at step " << engine.get_training_steps() << std::endl;
+        }
+        engine.enable_checkpoints(checkpoint_dir, checkpoint_every, keep_checkpoints);
+    }
+    
+    BrainLLM::DataLoader loader(options, engine.get_tokenizer());
+    if (!loader.start()) {
+        std::cerr << loader.error() << std::endl;
+        return 1;
+    }
+    
+    // Train in slices so progress is reported while the corpus streams
+    const size_t report_every = 100;
+    auto start = std::chrono::steady_clock::now();
+    size_t trained = 0;
+    while (max_batches == 0 || trained < max_batches) {
+        size_t slice = max_batches == 0 ? report_every : std::min(report_every, max_batches - trained);
+        size_t done = engine.train(loader, slice);
+        trained += done;
+        
+        auto stats = loader.get_stats();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << trained << " batches, " << stats.sequences << " sequences from " << stats.documents
+                  << " documents (" << stats.bytes / (1024.0 * 1024.0) << " MB), "
+                  << (seconds > 0.0 ? trained * options.batch_size * options.sequence_length / seconds : 0.0)
+                  << " tokens/s, accuracy " << engine.get_metrics().accuracy << ", trainer waited "
+                  << stats.trainer_waits << " times" << std::endl;
+        if (done < slice) break;
+    }
+    
+    loader.stop();
+    if (checkpoint_dir) {
+        engine.save_checkpoint();
+        engine.flush_checkpoints();
+        std::cout << "Saved checkpoint at step " << engine.get_training_steps() << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+// train_tokenizer - learns BPE merges for BrainLLM from plain-text files.
+//
+//   train_tokenizer [--vocab-size N] --output FILE CORPUS...
+//
+// Each corpus file is read whole; pass the result to BrainLLM_API with
+// --tokenizer FILE.
+
+#include "tokenizer.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    size_t vocab_size = 2048;
+    std::string output;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--vocab-size") == 0 && i + 1 < argc) {
+            vocab_size = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (output.empty() || inputs.empty()) {
+        std::cerr << "Usage: train_tokenizer [--vocab-size N] --output FILE CORPUS..." << std::endl;
+        return 1;
+    }
+    
+    std::vector<std::string> corpus;
+    size_t corpus_bytes = 0;
+    for (const auto& path : inputs) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Cannot read " << path << std::endl;
+            return 1;
+        }
+        std::ostringstream text;
+        text << file.rdbuf();
+        corpus.push_back(text.str());
+        corpus_bytes += corpus.back().size();
+    }
+    
+    BrainLLM::BpeTokenizer tokenizer;
+    tokenizer.train(corpus, vocab_size);
+    if (!tokenizer.save(output)) {
+        std::cerr << "Cannot write " << output << std::endl;
+        return 1;
+    }
+    
+    size_t tokens = 0;
+    for (const auto& text : corpus) {
+        tokens += tokenizer.encode(text).size();
+    }
+    std::cout << "Learned " << tokenizer.merge_count() << " merges (vocabulary " << tokenizer.vocab_size()
+              << "); corpus compresses " << corpus_bytes << " bytes to " << tokens << " tokens ("
+              << (tokens ? static_cast<double>(corpus_bytes) / tokens : 0.0) << " bytes/token)" << std::endl;
+    return 0;
+}